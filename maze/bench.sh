@@ -0,0 +1,121 @@
+#!/bin/sh
+# Maze Benchmarks
+#
+# Times the generator and solver on seeded mazes of several sizes and appends
+# the results to a CSV file, one row per timed step:
+#
+#   run,commit,size,rows,columns,stage,name,format,count,unit,seconds
+#
+# Stages are generate (each algorithm step and the write of the maze, per maze
+# file format), parse (loading each maze file format), solve (each solver
+# engine from corner to corner, with the rooms it expanded), distances (the
+# distance field from a corner in each width), stats and validate (measuring
+# and checking the maze with every core) and output (writing the longest
+# result in each path format, with its size in bytes). Mazes are
+# generated from a fixed seed, so runs on the same commit measure the same work.
+#
+# Sizes, chosen by the number of bytes of packed rooms:
+#   small  256 x 256       32 KB, fits in L1/L2
+#   l2     1024 x 2048     1 MB, about an L2 cache
+#   l3     4096 x 8192     16 MB, about an L3 cache
+#   huge   BENCH_HUGE_ROWS x BENCH_HUGE_COLUMNS, streamed by Eller's algorithm
+#          to /dev/null; by default larger than RAM, so only generation is timed
+#
+# Usage: ./bench.sh [results file, bench.csv by default]
+# Environment: BENCH_SIZES (default "small l2 l3"), BENCH_SEED (default 1),
+#              BENCH_DIR for the mazes (default a temporary directory),
+#              BENCH_HUGE_ROWS, BENCH_HUGE_COLUMNS (default 100000 each)
+
+set -e
+cd "$(dirname "$0")"
+
+out=${1:-bench.csv}
+sizes=${BENCH_SIZES:-small l2 l3}
+seed=${BENCH_SEED:-1}
+run=$(date -u +%Y-%m-%dT%H:%M:%SZ)
+commit=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+dir=${BENCH_DIR:-$(mktemp -d)}
+[ -n "$BENCH_DIR" ] || trap 'rm -rf "$dir"' EXIT
+mkdir -p "$dir"
+
+[ -s "$out" ] || echo "run,commit,size,rows,columns,stage,name,format,count,unit,seconds" > "$out"
+
+# record <stage> <format> <step> <command...>
+# Runs a command with its --time report on stderr and appends a row for every
+# "<name>: <count> <unit> in <seconds> s (<rate> <unit>/s)" and
+# "<name>: <count> rooms expanded" line, or only for the lines of one step
+# unless step is -. Seconds are worked out from the rate, which is printed to
+# more significant digits than the seconds of a short step.
+record() {
+    stage=$1
+    format=$2
+    step=$3
+    shift 3
+    "$@" 2>&1 >/dev/null | awk -v prefix="$run,$commit,$size,$rows,$columns,$stage" -v format="$format" -v step="$step" '
+        { sub(":$", "", $1) }
+        step != "-" && $1 != step { next }
+        $4 == "in" && $6 == "s" {
+            seconds = substr($7, 2) > 0 ? sprintf("%.6g", $2 / substr($7, 2)) : $5
+            print prefix "," $1 "," format "," $2 "," $3 "," seconds
+        }
+        $3 == "rooms" && $4 == "expanded" { print prefix "," $1 "-expanded," format "," $2 ",rooms," }
+    ' >> "$out"
+}
+
+# bytes <stage> <format> <file>: appends a row with the size of a file
+bytes() {
+    echo "$run,$commit,$size,$rows,$columns,$1,size,$2,$(wc -c < "$3"),bytes," >> "$out"
+}
+
+engines=$(./solver 2>/dev/null | awk '/^Engines:/ { listed = 1; next } listed { print $1 }')
+
+for size in $sizes
+do
+    case $size in
+        small) rows=256; columns=256 ;;
+        l2) rows=1024; columns=2048 ;;
+        l3) rows=4096; columns=8192 ;;
+        huge) rows=${BENCH_HUGE_ROWS:-100000}; columns=${BENCH_HUGE_COLUMNS:-100000} ;;
+        *) echo "Unknown size $size, expected small, l2, l3 or huge" >&2; exit 1 ;;
+    esac
+    echo "$size: $rows x $columns" >&2
+
+    if [ "$size" = huge ]
+    then
+        record generate hex - ./generator --time --seed "$seed" --stream - "$rows" "$columns"
+        continue
+    fi
+    record generate hex - ./generator --time --seed "$seed" --format hex "$dir/maze.hex" "$rows" "$columns"
+    record generate binary - ./generator --time --seed "$seed" --format binary "$dir/maze.binary" "$rows" "$columns"
+    record generate tree - ./generator --time --seed "$seed" --format tree "$dir/maze.tree" "$rows" "$columns"
+    record generate hex-tiled - ./generator --time --seed "$seed" --threads 0 "$dir/tiled.txt" "$rows" "$columns"
+    record generate hex-stream - ./generator --time --seed "$seed" --stream "$dir/stream.txt" "$rows" "$columns"
+
+    for format in hex binary tree
+    do
+        record parse "$format" load ./solver --time --engine bfs "$dir/maze.$format" "$rows" "$columns" /dev/null 0 0 "$rows" "$columns"
+    done
+
+    rm -f "$dir/maze.hex.lca"
+    for engine in $engines
+    do
+        record solve hex - ./solver --time --engine "$engine" "$dir/maze.hex" "$rows" "$columns" /dev/null 0 0 "$rows" "$columns"
+    done
+    record solve hex-indexed - ./solver --time --engine lca "$dir/maze.hex" "$rows" "$columns" /dev/null 0 0 "$rows" "$columns"
+
+    for width in uint32 uint16
+    do
+        record distances "$width" - ./solver --time --distances "$width" "$dir/maze.binary" "$rows" "$columns" /dev/null 0 0
+    done
+
+    record stats binary stats ./solver --time --threads 0 --stats "$dir/maze.binary" "$rows" "$columns" /dev/null
+    record validate binary validate ./solver --time --threads 0 --validate "$dir/maze.binary" "$rows" "$columns" /dev/null
+
+    for format in text rle packed
+    do
+        record output "$format" write ./solver --time --engine dfs-full --format "$format" "$dir/maze.binary" "$rows" "$columns" "$dir/path.$format" 0 0 "$rows" "$columns"
+        bytes output "$format" "$dir/path.$format"
+    done
+    rm -f "$dir/maze.hex" "$dir/maze.hex.lca" "$dir/maze.binary" "$dir/maze.tree" "$dir/tiled.txt" "$dir/stream.txt" "$dir"/path.*
+done
+echo "Results appended to $out" >&2
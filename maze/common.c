@@ -1,16 +1,158 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "common.h"
+
+const int EastWestOffset[4] = {1,-1,0,0};
+const int SouthNorthOffset[4] = {0,0,1,-1};
+
 /* Function roomOutOfBounds
 
-   Determines whether a location is out of bounds of the maze 
+   Determines whether a location is out of bounds of the maze
 
    Input: row - the row position
           column - the column position
           cols - the number of columns in maze
           rows - the number of rows in maze
- 
-   Output: Int 0 if location is in bounds and 1 if location is out of bounds of maze 
+
+   Output: Int 0 if location is in bounds and 1 if location is out of bounds of maze
 */
 int roomOutOfBounds(int row, int column, int cols, int rows) {
     if((row >= 0 && row < rows) && (column >= 0 && column < cols))
         return 0;
     return 1;
 }
+
+/* Function createMaze
+
+   Allocates the packed cells and visited bitmap of a maze. Every room starts
+   with the given hex value and unvisited.
+
+   Input: m - the maze to initialize
+          rows - the number of rows in maze
+          columns - the number of columns in maze
+          hexValue - the initial wall bits of every room
+
+   Output: 1 if the maze was allocated and 0 if out of memory
+*/
+int createMaze(struct maze *m, int rows, int columns, unsigned int hexValue) {
+    unsigned char *cells = malloc((size_t)rows * (((size_t)columns + 1) / 2));
+    if(cells == NULL || createMazeOver(m, rows, columns, cells, NULL, 0) == 0)
+    {
+        free(cells);
+        return 0;
+    }
+    hexValue &= ALLWALLS;
+    memset(m->cells, (int)(hexValue << 4 | hexValue), (size_t)rows * m->stride);
+    return 1;
+}
+
+/* Function createMazeOver
+
+   Sets up a maze over packed cells that already exist, such as a mapped maze
+   file. Only the visited bitmap is allocated; the maze takes ownership of the
+   cells, or of the mapping when one is given.
+
+   Input: m - the maze to initialize
+          rows - the number of rows in maze
+          columns - the number of columns in maze
+          cells - the packed cells, ((columns + 1) / 2) bytes per row
+          mapping, mappingLength - the file mapping holding the cells, or NULL and 0
+
+   Output: 1 if the maze was set up and 0 if out of memory
+*/
+int createMazeOver(struct maze *m, int rows, int columns, unsigned char *cells, void *mapping, size_t mappingLength) {
+    m->rows = rows;
+    m->columns = columns;
+    m->stride = ((size_t)columns + 1) / 2;
+    m->visitedStride = ((size_t)columns + 63) / 64;
+    m->cells = cells;
+    m->mapping = mapping;
+    m->mappingLength = mappingLength;
+    m->cellsCapacity = (mapping == NULL) ? (size_t)rows * m->stride : 0;
+    m->visitedCapacity = (size_t)rows * m->visitedStride;
+    m->visited = calloc(m->visitedCapacity, sizeof(uint64_t));
+    if(m->visited == NULL)
+    {
+        m->cells = NULL;
+        m->mapping = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+/* Function resizeMaze
+
+   Reuses an allocated maze for a maze of another size. The cells and visited
+   bitmap are only reallocated when they are too small, so a worker generating
+   many mazes keeps one set of buffers. Every room is reset to hexValue and
+   unvisited.
+
+   Input: m - an allocated maze, or one zeroed with every field 0 and NULL
+          rows - the number of rows in maze
+          columns - the number of columns in maze
+          hexValue - the initial wall bits of every room
+
+   Output: 1 if the maze was resized and 0 if out of memory
+*/
+int resizeMaze(struct maze *m, int rows, int columns, unsigned int hexValue) {
+    size_t stride = ((size_t)columns + 1) / 2;
+    size_t visitedStride = ((size_t)columns + 63) / 64;
+    if((size_t)rows * stride > m->cellsCapacity)
+    {
+        unsigned char *cells = realloc(m->cells, (size_t)rows * stride);
+        if(cells == NULL)
+            return 0;
+        m->cells = cells;
+        m->cellsCapacity = (size_t)rows * stride;
+    }
+    if((size_t)rows * visitedStride > m->visitedCapacity)
+    {
+        uint64_t *visited = realloc(m->visited, (size_t)rows * visitedStride * sizeof(uint64_t));
+        if(visited == NULL)
+            return 0;
+        m->visited = visited;
+        m->visitedCapacity = (size_t)rows * visitedStride;
+    }
+    m->rows = rows;
+    m->columns = columns;
+    m->stride = stride;
+    m->visitedStride = visitedStride;
+    hexValue &= ALLWALLS;
+    memset(m->cells, (int)(hexValue << 4 | hexValue), (size_t)rows * stride);
+    clearVisited(m);
+    return 1;
+}
+
+/* Function destroyMaze
+
+   Releases the cells (or the file mapping holding them) and visited bitmap of a maze
+
+   Input: m - the maze to release
+
+   Output: Void
+*/
+void destroyMaze(struct maze *m) {
+    if(m->mapping != NULL)
+        munmap(m->mapping, m->mappingLength);
+    else
+        free(m->cells);
+    free(m->visited);
+    m->cells = NULL;
+    m->visited = NULL;
+    m->mapping = NULL;
+    m->cellsCapacity = 0;
+    m->visitedCapacity = 0;
+}
+
+/* Function clearVisited
+
+   Marks every room of a maze as unvisited
+
+   Input: m - the maze to clear
+
+   Output: Void
+*/
+void clearVisited(struct maze *m) {
+    memset(m->visited, 0, (size_t)m->rows * m->visitedStride * sizeof(uint64_t));
+}
@@ -1,3 +1,9 @@
+#ifndef COMMON_H
+#define COMMON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
 /* Directions of maze */
 #define EAST 0
 #define WEST 1
@@ -15,17 +21,112 @@
 #define SOUTHHEX 2
 #define NORTHHEX 1
 
-int MAZE_ROWS = 0;
-int MAZE_COLUMNS = 0;
+/* Hex value of a room with all four walls */
+#define ALLWALLS 0xf
+
+/* The hex bit of the wall in a given direction */
+#define DIRECTION_HEX(direction) (EASTHEX >> (direction))
 
-/* Represents a room */
-struct room {
-    int row, column, visited, east, west, south, north;
+/* Reverse of a direction: EAST <-> WEST and SOUTH <-> NORTH */
+#define OPPOSITE_DIRECTION(direction) ((direction) ^ 1)
+
+/* Represents a maze as a packed grid. Each room is one nibble of wall bits
+   (its hex value), two rooms per byte with the even column in the high nibble,
+   and every row padded to a whole byte. Whether a room has been visited is kept
+   in a separate bitmap whose rows are padded to whole 64-bit words. */
+struct maze {
+    int rows, columns;
+    size_t stride;          /* bytes per row of cells */
+    size_t visitedStride;   /* words per row of visited */
+    unsigned char *cells;
+    uint64_t *visited;
+    void *mapping;          /* file mapping the cells live in, NULL if allocated */
+    size_t mappingLength;
+    size_t cellsCapacity;   /* bytes allocated for cells, 0 if mapped */
+    size_t visitedCapacity; /* words allocated for visited */
 };
 
+extern const int EastWestOffset[4];
+extern const int SouthNorthOffset[4];
 
 /* Determines whether a given room is out of bounds */
 int roomOutOfBounds(int, int column, int cols, int rows);
 
-const int EastWestOffset[4] = {1,-1,0,0};
-const int SouthNorthOffset[4] = {0,0,1,-1};
+/* Allocates a maze of the given size with every room set to hexValue */
+int createMaze(struct maze *m, int rows, int columns, unsigned int hexValue);
+
+/* Sets up a maze of the given size whose cells live elsewhere, allocating only its visited bitmap */
+int createMazeOver(struct maze *m, int rows, int columns, unsigned char *cells, void *mapping, size_t mappingLength);
+
+/* Reuses the memory of an allocated maze for a maze of another size, growing it if needed */
+int resizeMaze(struct maze *m, int rows, int columns, unsigned int hexValue);
+
+/* Releases the memory held by a maze */
+void destroyMaze(struct maze *m);
+
+/* Clears the visited bitmap of a maze */
+void clearVisited(struct maze *m);
+
+/* Byte offset of the cell byte holding a room */
+static inline size_t roomOffset(const struct maze *m, int row, int column) {
+    return (size_t)row * m->stride + (column >> 1);
+}
+
+/* Shift of a room's nibble within its cell byte */
+static inline int roomShift(int column) {
+    return (~column & 1) << 2;
+}
+
+/* Hex value (wall bits) of a room */
+static inline unsigned int roomHexValue(const struct maze *m, int row, int column) {
+    return (m->cells[roomOffset(m, row, column)] >> roomShift(column)) & ALLWALLS;
+}
+
+/* Stores the hex value (wall bits) of a room */
+static inline void storeRoomHexValue(struct maze *m, int row, int column, unsigned int hexValue) {
+    unsigned char *cell = &m->cells[roomOffset(m, row, column)];
+    int shift = roomShift(column);
+    *cell = (*cell & ~(ALLWALLS << shift)) | ((hexValue & ALLWALLS) << shift);
+}
+
+/* Stores a connection of type connectionType (OPENING or WALL) for a room in a given direction */
+static inline void storeRoomConnection(struct maze *m, int row, int column, int connectionType, int direction) {
+    unsigned char *cell = &m->cells[roomOffset(m, row, column)];
+    unsigned char bit = DIRECTION_HEX(direction) << roomShift(column);
+    *cell = (connectionType == WALL) ? (*cell | bit) : (*cell & ~bit);
+}
+
+/* Determines whether a room has a wall in a given direction */
+static inline int roomHasWall(const struct maze *m, int row, int column, int direction) {
+    return (m->cells[roomOffset(m, row, column)] >> roomShift(column)) & DIRECTION_HEX(direction) ? 1 : 0;
+}
+
+/* Determines whether a room has an open connection in a given direction */
+static inline int roomHasOpenConnection(const struct maze *m, int row, int column, int direction) {
+    return !roomHasWall(m, row, column, direction);
+}
+
+/* Opens the wall between a room and its neighbor in a given direction, on both sides */
+static inline void openRoomConnection(struct maze *m, int row, int column, int direction) {
+    storeRoomConnection(m, row, column, OPENING, direction);
+    storeRoomConnection(m, row + SouthNorthOffset[direction], column + EastWestOffset[direction],
+                        OPENING, OPPOSITE_DIRECTION(direction));
+}
+
+/* Number of open sides in a set of hex bits */
+static inline unsigned int openSideCount(unsigned int hexBits) {
+    static const unsigned char counts[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+    return counts[hexBits & ALLWALLS];
+}
+
+/* Determines whether a room has been visited */
+static inline int roomVisited(const struct maze *m, int row, int column) {
+    return (m->visited[(size_t)row * m->visitedStride + (column >> 6)] >> (column & 63)) & 1;
+}
+
+/* Marks a room as visited */
+static inline void markRoomVisited(struct maze *m, int row, int column) {
+    m->visited[(size_t)row * m->visitedStride + (column >> 6)] |= (uint64_t)1 << (column & 63);
+}
+
+#endif
@@ -10,56 +10,86 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <time.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <stdatomic.h>
 #include "common.h"
-
-/* Directions of maze */
-#define EAST 0
-#define WEST 1
-#define SOUTH 2
-#define NORTH 3
-
-/* Connections of a room */
-#define UNINITIALIZED -1
-#define OPENING 0
-#define WALL 1
+#include "mazegen.h"
+#include "mazeio.h"
+#include "parallel.h"
+#include "rng.h"
+
+/* Size of the tiles generated independently in parallel generation. Tile columns
+   are a multiple of 64 so no two tiles share a cell byte or a visited word. */
+#define TILE_ROWS 256
+#define TILE_COLUMNS 256
+
+/* Shared state of a tiled generation */
+struct tiledWalk {
+    struct maze *maze;
+    const struct genEngine *engine;
+    int tileRows, tileColumns;      /* the number of tiles down and across */
+    uint64_t seed;
+    atomic_int nextTile;
+    atomic_int failed;
+};
+
+/* A maze to generate in batch mode */
+struct batchJob {
+    char *fileName;
+    int rows, columns;
+    uint64_t seed;
+};
+
+/* Shared state of a batch generation */
+struct batch {
+    struct batchJob *jobs;
+    size_t count;
+    int format;
+    const struct genEngine *engine;
+    atomic_size_t nextJob;
+    atomic_size_t failed;
+};
 
 /* Generates a maze, writing maze to a file with given fileName */
-void generateMaze(char *fileName);
+void generateMaze(char *fileName, int format, const struct genEngine *engine, int rows, int columns, uint64_t seed, int timed);
 
-/* Calculates the hexadecimal value for a given room */
-int calculateHexValue(struct room r);
+/* Generates a maze from independently generated tiles on several threads */
+void generateMazeTiled(char *fileName, int format, const struct genEngine *engine, int rows, int columns, int threads, uint64_t seed, int timed);
 
-/* Stores a connection of type connectionType for a room in a given direction */
-void storeRoomConnection(struct room *r, int connectionType, int direction);
+/* Generates the tiles of a tiled generation taken from a shared counter */
+void walkTiles(void *arg, int id);
 
-/* Determines whether a room has an initialized connection in a given direction */
-int roomHasConnection(struct room r, int direction);
+/* Reports how fast a generation algorithm carved a number of rooms */
+void reportThroughput(const char *name, double rooms, const struct timespec *start);
 
-/* Determines the type of connection a room has in a given direction */
-int connectionType(struct room r, int direction);
+/* Prints maze in hexadecimal, binary or tree form to an output file */
+void printMaze(struct maze *maze, char *fileName, int format, uint64_t seed);
 
-/* Creates a room a row and column and uninitialized connections */
-struct room createRoom(int row, int column);
+/* Generates every maze of a job list on a pool of worker threads */
+int generateBatch(char *jobFileName, int format, const struct genEngine *engine, int threads, int timed);
 
-/* Creates a maze of the correct specifications with uninitialized connections */
-void createMaze(int rows, int columns, struct room maze [MAZE_ROWS][MAZE_COLUMNS]);
+/* Reads a batch job list */
+struct batchJob *readBatchJobs(char *jobFileName, size_t *count);
 
-/* Performs drunken walk algorithm on a maze, setting connection borders */
-void drunkenWalkAlgorithm (int row, int column, struct room maze [MAZE_ROWS][MAZE_COLUMNS]);
+/* Generates the batch jobs taken from a shared counter */
+void generateBatchJobs(void *arg, int id);
 
-/* Prints maze in hexadecimal form to an output file */
-void printMaze(int rows, int columns, struct room maze [MAZE_ROWS][MAZE_COLUMNS], char *fileName);
+/* Generates a maze row by row with Eller's algorithm, writing each row as soon as it is final */
+int generateMazeStreaming(char *fileName, int format, int rows, int columns, uint64_t seed);
 
-/* Shuffles an array of directions */
-void shuffleDirections(int arr[4]);
+/* Finds the representative of a set in an Eller's algorithm row */
+unsigned int findSet(unsigned int *parent, unsigned int id);
 
-/* Outputs reverse direction */
-int findOppositeDirection(int a);
+/* Picks a seed from the clock and process id when none is given */
+uint64_t defaultSeed(void);
 
 /* Function main
 
    This function is where the program begins. Calls generateMaze to generate a hexadecimal
-   maze.
+   maze, generateMazeStreaming when --stream is given, generateMazeTiled
+   when --threads is given, or generateBatch when --batch is given.
 
    Input: int    argc - The number of program arguments, including the executable name
           char **argv - An array of strings containing the program arguments
@@ -67,320 +97,665 @@ int findOppositeDirection(int a);
    Output: 0 upon completion of the program
  */
 int main(int argc, char **argv) {
+    static struct option options[] = {
+        {"stream", no_argument, NULL, 's'},
+        {"threads", required_argument, NULL, 'j'},
+        {"seed", required_argument, NULL, 'S'},
+        {"format", required_argument, NULL, 'f'},
+        {"batch", required_argument, NULL, 'b'},
+        {"algorithm", required_argument, NULL, 'a'},
+        {"time", no_argument, NULL, 't'},
+        {NULL, 0, NULL, 0}
+    };
     char *fileName = NULL;
-    if(argc >= 4)
+    char *jobFileName = NULL;
+    int rows = 0, columns = 0;
+    int streaming = 0;
+    int threads = -1;
+    int seeded = 0;
+    uint64_t seed = 0;
+    int format = FORMAT_HEX;
+    const struct genEngine *engine = &genEngines[0];
+    const struct genEngine *e;
+    int timed = 0;
+    int opt;
+    while((opt = getopt_long(argc, argv, "sj:S:f:b:a:t", options, NULL)) != -1)
     {
-        fileName = strdup(argv[1]);
-        MAZE_ROWS = atoi(argv[2]);
-        MAZE_COLUMNS = atoi(argv[3]);
+        switch(opt)
+        {
+            case 's':
+                streaming = 1;
+                break;
+            case 'j':
+                threads = atoi(optarg);
+                if(threads == 0)
+                    threads = defaultThreadCount();
+                break;
+            case 'S':
+                seed = strtoull(optarg, NULL, 0);
+                seeded = 1;
+                break;
+            case 'f':
+                format = parseMazeFormat(optarg);
+                if(format < 0)
+                {
+                    fprintf(stderr, "Unknown format %s, expected hex, binary or tree\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'b':
+                jobFileName = optarg;
+                break;
+            case 'a':
+                engine = findGenEngine(optarg);
+                if(engine == NULL)
+                {
+                    fprintf(stderr, "Unknown algorithm %s, expected one of:\n", optarg);
+                    for(e = genEngines; e->name != NULL; e++)
+                        fprintf(stderr, "  %-12s %s\n", e->name, e->description);
+                    exit(1);
+                }
+                break;
+            case 't':
+                timed = 1;
+                break;
+            default:
+                exit(1);
+        }
+    }
+    if(jobFileName != NULL)
+    {
+        if(streaming)
+        {
+            fprintf(stderr, "--batch and --stream cannot be combined\n");
+            exit(1);
+        }
+        return generateBatch(jobFileName, format, engine, threads > 0 ? threads : defaultThreadCount(), timed) ? 0 : 1;
+    }
+    if(argc - optind >= 3)
+    {
+        fileName = strdup(argv[optind]);
+        rows = atoi(argv[optind + 1]);
+        columns = atoi(argv[optind + 2]);
     }
     else
     {
-        fprintf(stderr,"Usage %s <fileName> <Rows> <Columns>\n", argv[0]);
+        fprintf(stderr,"Usage %s [--seed <n>] [--format hex|binary|tree] [--algorithm <name>] [--time]\n"
+                       "          [--stream | --threads <n, 0 for all cores>] <fileName, - for stdout> <Rows> <Columns>\n", argv[0]);
+        fprintf(stderr,"      %s --batch <job file, - for stdin> [--format hex|binary|tree] [--algorithm <name>] [--time] [--threads <n>]\n", argv[0]);
+        fprintf(stderr,"Algorithms:\n");
+        for(e = genEngines; e->name != NULL; e++)
+            fprintf(stderr,"  %-12s %s\n", e->name, e->description);
         exit(0);
     }
-    if(fileName == NULL || MAZE_ROWS == 0 || MAZE_COLUMNS == 0)
+    if(fileName == NULL || rows <= 0 || columns <= 0)
         return 0;
-    srand(time(NULL));          //seed for random number generator
-    generateMaze(fileName);
+    if(streaming && threads > 0)
+    {
+        fprintf(stderr, "--stream and --threads cannot be combined\n");
+        exit(1);
+    }
+    if(streaming && format == FORMAT_TREE)
+    {
+        fprintf(stderr, "--stream writes hex or binary only\n");
+        exit(1);
+    }
+    /* report a picked seed so the maze can be generated again with --seed */
+    if(!seeded)
+    {
+        seed = defaultSeed();
+        fprintf(stderr, "seed %" PRIu64 "\n", seed);
+    }
+    if(threads > 0)
+    {
+        generateMazeTiled(fileName, format, engine, rows, columns, threads, seed, timed);
+    }
+    else if(streaming)
+    {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if(generateMazeStreaming(fileName, format, rows, columns, seed) == 0)
+        {
+            fprintf(stderr, "Unable to allocate row state for %d columns\n", columns);
+            exit(1);
+        }
+        if(timed)
+            reportThroughput("eller", (double)rows * columns, &start);
+    }
+    else
+    {
+        generateMaze(fileName, format, engine, rows, columns, seed, timed);
+    }
     return 0;
 }
 
 /* Function generateMaze
 
-   This function is where the program begins. Initializes a maze, performs drunken walk 
-   algorithm, and then prints the maze.
+   This function is where the program begins. Initializes a maze, runs a generation
+   algorithm over all of it, and then prints the maze.
 
    Input: char *fileName- The fileName of where to print the maze
+          format - the FORMAT_ to print the maze in
+          *engine - the generation algorithm
+          rows, columns - the size of the maze
+          seed - seed of the random number generator
+          timed - whether to report the algorithm's throughput and how long writing took
  
    Output: Void
  */
-void generateMaze(char *fileName) {
-    struct room maze[MAZE_ROWS][MAZE_COLUMNS];
-    createMaze(MAZE_ROWS, MAZE_COLUMNS, maze);
-    drunkenWalkAlgorithm(0, 0, maze);
-    printMaze(MAZE_ROWS, MAZE_COLUMNS, maze, fileName);
+void generateMaze(char *fileName, int format, const struct genEngine *engine, int rows, int columns, uint64_t seed, int timed) {
+    /* every room starts walled in; the algorithm opens connections between rooms */
+    struct maze maze;
+    struct region whole = {0, 0, rows, columns};
+    struct genScratch scratch = {NULL, 0};
+    struct timespec start;
+    struct rng rng;
+    rngSeed(&rng, seed, 0);
+    if(createMaze(&maze, rows, columns, ALLWALLS) == 0)
+    {
+        fprintf(stderr, "Unable to allocate a %d x %d maze\n", rows, columns);
+        exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(engine->generate(&maze, &whole, &scratch, &rng) == 0)
+    {
+        fprintf(stderr, "Unable to allocate %s working memory\n", engine->name);
+        exit(1);
+    }
+    if(timed)
+        reportThroughput(engine->name, (double)rows * columns, &start);
+    freeScratch(&scratch);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    printMaze(&maze, fileName, format, seed);
+    if(timed)
+        reportThroughput("write", (double)rows * columns, &start);
+    destroyMaze(&maze);
 }
 
-/* Function calculateHexValue
+/* Function generateMazeTiled
 
-   This function outputs the integer representation of a room
+   Generates a maze in parallel. The grid is split into TILE_ROWS x TILE_COLUMNS
+   tiles and worker threads run the generation algorithm on each tile on its own,
+   giving one spanning tree per tile. A drunken walk over the much smaller grid of
+   tiles then picks a spanning tree of tiles, and one random door is opened along
+   the border of every pair of tiles it connects. Joining spanning trees along a
+   spanning tree keeps the maze perfect. Every tile uses its own random stream of
+   the seed, so the maze depends on the seed but not on the number of threads.
 
-   Input: r - A room
- 
-   Output: The integer (decimal) conversion of a room
+   Input: char *fileName- The fileName of where to print the maze
+          format - the FORMAT_ to print the maze in
+          *engine - the generation algorithm run on each tile
+          rows, columns - the size of the maze
+          threads - the number of worker threads
+          seed - seed of the random number generator
+          timed - whether to report the throughput of the tiles, stitching and writing
+
+   Output: Void
  */
-int calculateHexValue(struct room r) {
-    int hexValue = 0;
-    
-    if(r.east)
-        hexValue |=8;
-    if(r.west)
-        hexValue |=4;
-    if(r.south)
-        hexValue |=2;
-    if(r.north)
-        hexValue |=1;
-    return hexValue;
+void generateMazeTiled(char *fileName, int format, const struct genEngine *engine, int rows, int columns, int threads, uint64_t seed, int timed) {
+    struct maze maze, tiles;
+    struct tiledWalk walk;
+    struct timespec start;
+    walk.maze = &maze;
+    walk.engine = engine;
+    walk.tileRows = (rows + TILE_ROWS - 1) / TILE_ROWS;
+    walk.tileColumns = (columns + TILE_COLUMNS - 1) / TILE_COLUMNS;
+    walk.seed = seed;
+    atomic_init(&walk.nextTile, 0);
+    atomic_init(&walk.failed, 0);
+    if(createMaze(&maze, rows, columns, ALLWALLS) == 0 ||
+       createMaze(&tiles, walk.tileRows, walk.tileColumns, ALLWALLS) == 0)
+    {
+        fprintf(stderr, "Unable to allocate a %d x %d maze\n", rows, columns);
+        exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(runParallel(threads, walkTiles, &walk) == 0 || atomic_load(&walk.failed))
+    {
+        fprintf(stderr, "Unable to allocate %s working memory\n", engine->name);
+        exit(1);
+    }
+
+    /* stitch: one door across each border the spanning tree of tiles opens */
+    struct region whole = {0, 0, walk.tileRows, walk.tileColumns};
+    struct genScratch scratch = {NULL, 0};
+    struct rng rng;
+    rngSeed(&rng, seed, 0);
+    if(drunkenWalkAlgorithm(&tiles, &whole, &scratch, &rng) == 0)
+    {
+        fprintf(stderr, "Unable to allocate the drunken walk stack\n");
+        exit(1);
+    }
+    freeScratch(&scratch);
+    int tr, tc;
+    for(tr = 0; tr < walk.tileRows; tr++)
+    {
+        for(tc = 0; tc < walk.tileColumns; tc++)
+        {
+            int top = tr * TILE_ROWS, left = tc * TILE_COLUMNS;
+            int height = (rows - top < TILE_ROWS) ? rows - top : TILE_ROWS;
+            int width = (columns - left < TILE_COLUMNS) ? columns - left : TILE_COLUMNS;
+            if(roomHasOpenConnection(&tiles, tr, tc, EAST))
+                openRoomConnection(&maze, top + rngBounded(&rng, height), left + width - 1, EAST);
+            if(roomHasOpenConnection(&tiles, tr, tc, SOUTH))
+                openRoomConnection(&maze, top + height - 1, left + rngBounded(&rng, width), SOUTH);
+        }
+    }
+    if(timed)
+        reportThroughput(engine->name, (double)rows * columns, &start);
+    destroyMaze(&tiles);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    printMaze(&maze, fileName, format, seed);
+    if(timed)
+        reportThroughput("write", (double)rows * columns, &start);
+    destroyMaze(&maze);
 }
 
-/* Function storeRoomConnection
+/* Function walkTiles
 
-   Stores a connection in a given room.
+   Worker of a tiled generation. Takes tiles from the shared counter until none
+   are left and runs the generation algorithm on each one, reusing one scratch
+   memory for all of them.
 
-   Input: r - the room to modify the connection in
-          connectionType - the type of connection (-1 if uninitialized, 0 if opening, and 1 if wall)
-          direction - the direction of the connection
- 
-   Output: Void. 
-*/
-void storeRoomConnection(struct room *r, int connectionType, int direction) {
-    switch(direction)
+   Input: *arg - the shared tiledWalk
+          id - the worker number (unused; tiles are shared through the counter)
+
+   Output: Void
+ */
+void walkTiles(void *arg, int id) {
+    struct tiledWalk *walk = arg;
+    struct genScratch scratch = {NULL, 0};
+    int tile;
+    (void)id;
+    while((tile = atomic_fetch_add(&walk->nextTile, 1)) < walk->tileRows * walk->tileColumns)
     {
-        case EAST:
-            r->east = connectionType;
-            break;
-        case WEST:
-            r->west = connectionType;
-            break;
-        case SOUTH:
-            r->south = connectionType;
-            break;
-        case NORTH:
-            r->north = connectionType;
+        struct region region;
+        region.top = (tile / walk->tileColumns) * TILE_ROWS;
+        region.left = (tile % walk->tileColumns) * TILE_COLUMNS;
+        region.rows = (walk->maze->rows - region.top < TILE_ROWS) ? walk->maze->rows - region.top : TILE_ROWS;
+        region.columns = (walk->maze->columns - region.left < TILE_COLUMNS) ? walk->maze->columns - region.left : TILE_COLUMNS;
+        struct rng rng;
+        rngSeed(&rng, walk->seed, (uint64_t)tile + 1);
+        if(walk->engine->generate(walk->maze, &region, &scratch, &rng) == 0)
+        {
+            atomic_store(&walk->failed, 1);
             break;
+        }
     }
+    freeScratch(&scratch);
 }
 
-/* Function roomHasConnection
+/* Function reportThroughput
 
-   Determines whether a room has a connection in a given direction
+   Reports on stderr how fast a generation algorithm carved a number of rooms
 
-   Input: r - the room to check connection in
-          direction - the direction of connection
- 
-   Output: Returns 1 if room has initialized connection and 0 if no connection 
-*/
-int roomHasConnection(struct room r, int direction) {
-    switch(direction)
-    {
-        case EAST:
-            return (r.east == 1 ? 1 : 0);
-        case WEST:
-            return (r.west == 1 ? 1 : 0);
-        case SOUTH:
-            return (r.south == 1 ? 1 : 0);
-        case NORTH:
-            return (r.north == 1 ? 1 : 0);
-    }
-    return -1;
+   Input: *name - the name of the algorithm
+          rooms - the number of rooms generated
+          *start - when generation started, on CLOCK_MONOTONIC
+
+   Output: Void
+ */
+void reportThroughput(const char *name, double rooms, const struct timespec *start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+    fprintf(stderr, "%s: %.0f rooms in %.3f s (%.0f rooms/s)\n", name, rooms, seconds, seconds > 0 ? rooms / seconds : 0.0);
 }
 
-/* Function connectionType
+/* Function printMaze
 
-   Determines the type of connection a room has in a given direction
+   Prints maze to an output file, one row at a time through a buffered mazeWriter.
 
-   Input: r - the room to check connection in
-          direction - the direction of connection
+   Input: *maze - the maze
+          *fileName - pointer to fileName of output file, "-" for stdout
+          format - FORMAT_HEX, FORMAT_BINARY or FORMAT_TREE
+          seed - the seed recorded in a binary or tree header
  
-   Output: Returns the integer representation of the connection in room r in direction
+   Output: Void
 */
-int connectionType(struct room r, int direction) {
-    int dir = -1;
-    switch(direction)
+void printMaze(struct maze *maze, char *fileName, int format, uint64_t seed) {
+    struct mazeWriter w;
+    if(openMazeWriter(&w, fileName) == 0)
     {
-        case EAST:
-            dir = r.east;
-        case WEST:
-            dir = r.west;
-        case SOUTH:
-            dir = r.south;
-        case NORTH:
-            dir = r.north;
+        fprintf(stderr, "Unable to open %s\n", fileName);
+        exit(1);
+    }
+    writeMaze(&w, format, maze, seed);
+    if(closeMazeWriter(&w) == 0)
+    {
+        fprintf(stderr, "Error writing %s\n", fileName);
+        exit(1);
     }
-    return dir;
 }
 
-/* Function createRoom
-
-   Creates a room with uninitialized connections
-
-   Input: row - the row of the room
-          column - the column of the room
- 
-   Output: A struct room storing (row, column) and uninitialized connections
-*/
-struct room createRoom(int row, int column) {
-    /* the row and column of the room */
-    struct room r;
-    r.east = UNINITIALIZED;
-    r.west = UNINITIALIZED;
-    r.south = UNINITIALIZED;
-    r.north = UNINITIALIZED;
-    r.visited = 0;
-    r.row = row;
-    r.column = column;
-    return r;
-    /* whether or not the room has been visited, where 0 is unvisited, 1 visited */
-
-    /* whether that connection is a wall, opening, or is uninitialized, where -1 is uninitialized, 0 opening, 1 wall */
-}
+/* Function findSet
 
-/* Function createMaze
+   Finds the representative of a set in the union-find forest of an Eller's
+   algorithm row, halving the path on the way up.
 
-   Creates a maze with rooms with uninitialized connections
+   Input: parent - the union-find parent of each set id in the row
+          id - the set id to look up
 
-   Input: rows - the number of rows of maze
-          columns - the number of columns of maze
-          room maze [][] - the maze to create rooms in
- 
-   Output: Void
+   Output: The representative set id
 */
-void createMaze(int rows, int columns, struct room maze [MAZE_ROWS][MAZE_COLUMNS]) {
-    int r,c;
-    for(r = 0; r < rows; r++)
+unsigned int findSet(unsigned int *parent, unsigned int id) {
+    while(parent[id] != id)
     {
-        for(c = 0; c < columns; c++)
-        {
-            maze[r][c] = createRoom(r,c);
-        }
+        parent[id] = parent[parent[id]];
+        id = parent[id];
     }
+    return id;
 }
 
-/* Function printMaze
+/* Function readBatchJobs
 
-   Prints maze to an output file.
+   Reads a batch job list: one maze per line as "<fileName> <Rows> <Columns> <seed>".
+   Blank lines and lines starting with # are skipped.
 
-   Input: rows - the number of rows of maze
-          columns - the number of columns of maze
-          room maze [][] - the maze
-          *fileName - pointer to fileName of output file
- 
-   Output: Void
+   Input: *jobFileName - the job list, or "-" for stdin
+          *count - set to the number of jobs read
+
+   Output: The jobs (free each fileName and the array), or NULL on a bad job list
 */
-void printMaze(int rows, int columns, struct room maze [MAZE_ROWS][MAZE_COLUMNS], char *fileName) {
-    FILE *fp;       //Pointer to file pointer
-    fp = fopen(fileName, "w+");
-    assert(fp != NULL);
-    int r,c;
-    for(r = 0; r < rows; r++)
+struct batchJob *readBatchJobs(char *jobFileName, size_t *count) {
+    FILE *fp = strcmp(jobFileName, "-") == 0 ? stdin : fopen(jobFileName, "r");
+    if(fp == NULL)
     {
-        for(c = 0; c < columns; c++)
+        fprintf(stderr, "Unable to open %s\n", jobFileName);
+        return NULL;
+    }
+    struct batchJob *jobs = NULL;
+    size_t capacity = 0, n = 0, lineNumber = 0;
+    char *line = NULL;
+    size_t lineCapacity = 0;
+    int ok = 1;
+    while(getline(&line, &lineCapacity, fp) != -1)
+    {
+        lineNumber++;
+        char *p = line + strspn(line, " \t");
+        if(*p == '#' || *p == '\n' || *p == '\0')
+            continue;
+        char name[4096];
+        struct batchJob job;
+        if(sscanf(p, "%4095s %d %d %" SCNu64, name, &job.rows, &job.columns, &job.seed) != 4 ||
+           job.rows <= 0 || job.columns <= 0)
         {
-            fprintf(fp, "%x", calculateHexValue(maze[r][c]));
+            fprintf(stderr, "%s:%zu: expected <fileName> <Rows> <Columns> <seed>\n", jobFileName, lineNumber);
+            ok = 0;
+            break;
+        }
+        if(n == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 64;
+            struct batchJob *grown = realloc(jobs, capacity * sizeof(struct batchJob));
+            if(grown == NULL)
+            {
+                ok = 0;
+                break;
+            }
+            jobs = grown;
         }
-        fprintf(fp, "\n");
+        job.fileName = strdup(name);
+        jobs[n++] = job;
     }
-    fclose(fp);
+    free(line);
+    if(fp != stdin)
+        fclose(fp);
+    if(!ok)
+    {
+        while(n > 0)
+            free(jobs[--n].fileName);
+        free(jobs);
+        return NULL;
+    }
+    *count = n;
+    return jobs;
 }
 
-/* Function shuffleDirections
+/* Function generateBatch
 
-   Shuffles array of directions by randomizing order
+   Generates every maze of a job list in one process. Worker threads take jobs
+   from a shared counter and keep their maze, walk stack and write buffer
+   between jobs, so a maze costs one walk and one file write rather than a
+   process start. Each job is generated exactly as "generator --seed <seed>"
+   would generate it.
 
-   Input: arr[4] - Array of north, south, east, west
- 
-   Output: Void
+   Input: *jobFileName - the job list, or "-" for stdin
+          format - the FORMAT_ to write the mazes in
+          *engine - the generation algorithm
+          threads - the number of worker threads
+          timed - whether to report the rooms per second of the whole batch
+
+   Output: 1 if every maze was written and 0 otherwise
 */
-void shuffleDirections(int arr[4]) { 
-    int i = 0;
-    int temp;
-    int randomNumber;
-    for(i = 0; i < 4; i++)
+int generateBatch(char *jobFileName, int format, const struct genEngine *engine, int threads, int timed) {
+    struct batch batch;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    batch.jobs = readBatchJobs(jobFileName, &batch.count);
+    if(batch.jobs == NULL)
+        return 0;
+    batch.format = format;
+    batch.engine = engine;
+    atomic_init(&batch.nextJob, 0);
+    atomic_init(&batch.failed, 0);
+    if(runParallel(threads, generateBatchJobs, &batch) == 0)
+    {
+        fprintf(stderr, "Unable to start batch workers\n");
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    size_t failed = atomic_load(&batch.failed);
+    fprintf(stderr, "generated %zu mazes in %.3f s (%.0f mazes/s)", batch.count - failed, seconds,
+            seconds > 0 ? (batch.count - failed) / seconds : 0.0);
+    if(failed > 0)
+        fprintf(stderr, ", %zu failed", failed);
+    fprintf(stderr, "\n");
+    size_t i;
+    double rooms = 0;
+    for(i = 0; i < batch.count; i++)
     {
-        randomNumber = rand() % 4;
-        temp = arr[randomNumber];
-        arr[randomNumber] = arr[i];
-        arr[i] = temp;
+        rooms += (double)batch.jobs[i].rows * batch.jobs[i].columns;
+        free(batch.jobs[i].fileName);
     }
+    if(timed)
+        reportThroughput(engine->name, rooms, &start);
+    free(batch.jobs);
+    return failed == 0;
 }
 
-/* Function findOppositeDirection
+/* Function generateBatchJobs
 
-   Returns opposite direction.
+   Worker of a batch generation. Takes jobs from the shared counter until none
+   are left, reusing one maze, scratch memory and write buffer for all of them.
 
-   Input: dir - an integer representation of direction
- 
-   Output: The integer representation of the opposite direction
+   Input: *arg - the shared batch
+          id - the worker number (unused; jobs are shared through the counter)
+
+   Output: Void
 */
-int findOppositeDirection(int dir) {
-    switch(dir)
+void generateBatchJobs(void *arg, int id) {
+    struct batch *batch = arg;
+    struct maze maze;
+    struct genScratch scratch = {NULL, 0};
+    struct mazeWriter w;
+    char *buffer = malloc(WRITER_BUFFER_SIZE);
+    size_t i;
+    (void)id;
+    memset(&maze, 0, sizeof(maze));
+    while((i = atomic_fetch_add(&batch->nextJob, 1)) < batch->count)
     {
-        case EAST:
-            return WEST;
-        case WEST:
-            return EAST;
-        case SOUTH:
-            return NORTH;
-        case NORTH:
-            return SOUTH;
+        struct batchJob *job = &batch->jobs[i];
+        struct region whole = {0, 0, job->rows, job->columns};
+        struct rng rng;
+        rngSeed(&rng, job->seed, 0);
+        if(buffer == NULL || resizeMaze(&maze, job->rows, job->columns, ALLWALLS) == 0 ||
+           batch->engine->generate(&maze, &whole, &scratch, &rng) == 0)
+        {
+            fprintf(stderr, "%s: out of memory\n", job->fileName);
+            atomic_fetch_add(&batch->failed, 1);
+            continue;
+        }
+        if(openMazeWriterWithBuffer(&w, job->fileName, buffer) == 0)
+        {
+            fprintf(stderr, "Unable to open %s\n", job->fileName);
+            atomic_fetch_add(&batch->failed, 1);
+            continue;
+        }
+        writeMaze(&w, batch->format, &maze, job->seed);
+        if(closeMazeWriter(&w) == 0)
+        {
+            fprintf(stderr, "Error writing %s\n", job->fileName);
+            atomic_fetch_add(&batch->failed, 1);
+        }
     }
-    return -1;
+    destroyMaze(&maze);
+    freeScratch(&scratch);
+    free(buffer);
 }
 
-/* Function drunkenWalkAlgorithm
+/* Function generateMazeStreaming
 
-   Performs the drunken walk algorithm on a maze.
+   Generates a maze with Eller's algorithm. Only the current row is kept: each
+   room carries a set id naming the rooms above it is already connected to.
+   Adjacent rooms in different sets are joined at random, then every set opens
+   at least one room south into the next row, which is when the row is final
+   and written out. The last row joins every remaining set. Memory is bounded
+   by the number of columns regardless of the number of rows.
 
-   Input: row - integer row of current room
-          column - integer column of current room
-          struct room maze [][] - the maze to perform drunken walk on
+   Input: *fileName - pointer to fileName of output file, "-" for stdout
+          format - the FORMAT_ to print the maze in
+          rows, columns - the size of the maze
+          seed - seed of the random number generator
 
-   Output: Void
+   Output: 1 on success and 0 if the row state could not be allocated
 */
-void drunkenWalkAlgorithm(int row, int column, struct room maze [MAZE_ROWS][MAZE_COLUMNS]){
-    struct room *r = &maze[row][column];
-    struct room neighbor;
-    r->visited = 1;
-
-    /* create random order of directions */
-    int direction[4] = {EAST, WEST, SOUTH, NORTH};
-    shuffleDirections(direction);
-    /* for each direction dir in random order: */
-    int i = 0;
-    int tempR = 0, tempC = 0;
-    for(i = 0; i < 4; i++)
+int generateMazeStreaming(char *fileName, int format, int rows, int columns, uint64_t seed) {
+    unsigned int *set = malloc(columns * sizeof(unsigned int));       /* set id of each room in the row */
+    unsigned int *parent = malloc(columns * sizeof(unsigned int));    /* union-find over set ids */
+    unsigned int *count = malloc(columns * sizeof(unsigned int));     /* rooms of each set not yet considered for going south */
+    unsigned int *label = malloc(columns * sizeof(unsigned int));     /* set id in the next row of each representative */
+    unsigned char *southOpen = malloc(columns);                       /* each set that already opened south */
+    unsigned char *hex = malloc(columns);                             /* wall bits of the row */
+    unsigned char *packed = malloc((columns + 1) / 2);                /* the row packed two rooms per byte */
+    struct mazeWriter w;
+    struct rng rng;
+    int ok = 0;
+    rngSeed(&rng, seed, 0);
+    if(set == NULL || parent == NULL || count == NULL || label == NULL || southOpen == NULL || hex == NULL || packed == NULL)
+        goto done;
+    if(openMazeWriter(&w, fileName) == 0)
     {
-        tempR = row + SouthNorthOffset[direction[i]];
-        tempC = column + EastWestOffset[direction[i]];
-        /* if neighbor is out of bounds */
-        /* store a wall in r at direction dir */
-        
-        if(roomOutOfBounds(tempR, tempC, MAZE_ROWS, MAZE_COLUMNS))
+        fprintf(stderr, "Unable to open %s\n", fileName);
+        exit(1);
+    }
+    writeMazeHeader(&w, format, rows, columns, seed);
+
+    int r, c;
+    for(c = 0; c < columns; c++)
+    {
+        set[c] = c;
+        hex[c] = ALLWALLS;
+    }
+    for(r = 0; r < rows; r++)
+    {
+        int lastRow = (r == rows - 1);
+        for(c = 0; c < columns; c++)
+            parent[c] = c;
+
+        /* join adjacent rooms of different sets at random, or always on the last row */
+        for(c = 0; c < columns - 1; c++)
         {
-            storeRoomConnection(r, WALL, direction[i]);
+            unsigned int a = findSet(parent, set[c]);
+            unsigned int b = findSet(parent, set[c + 1]);
+            if(a != b && (lastRow || rngBit(&rng)))
+            {
+                parent[b] = a;
+                hex[c] &= ~EASTHEX;
+                hex[c + 1] &= ~WESTHEX;
+            }
         }
-        else
-        {       
-            neighbor = maze[tempR][tempC];
-            if(!neighbor.visited)
+
+        /* each set opens south at random, and at its last room if it has not yet */
+        if(!lastRow)
+        {
+            for(c = 0; c < columns; c++)
             {
-                storeRoomConnection(r, OPENING, direction[i]);
-                drunkenWalkAlgorithm(tempR, tempC, maze);
+                set[c] = findSet(parent, set[c]);
+                count[set[c]] = 0;
+                southOpen[set[c]] = 0;
+                label[set[c]] = columns;
             }
-            else
+            for(c = 0; c < columns; c++)
+                count[set[c]]++;
+            for(c = 0; c < columns; c++)
             {
-
-                int opposite_Direction = findOppositeDirection(direction[i]);
-                if(roomHasConnection(maze[tempR][tempC], opposite_Direction))
-                {
-
-                    storeRoomConnection(r, connectionType(maze[tempR][tempC], opposite_Direction), direction[i]);
-                }   
-                else
+                unsigned int root = set[c];
+                int mustOpen = (--count[root] == 0 && !southOpen[root]);
+                if(mustOpen || rngBit(&rng))
                 {
-
-                    storeRoomConnection(r, WALL, direction[i]);
+                    hex[c] &= ~SOUTHHEX;
+                    southOpen[root] = 1;
                 }
             }
         }
 
-        /* else if neighbor has not yet been visited */
-        /* store an opening in r at direction dir */
-        /* drunken_walk(neighbor.x, neighbor.y) */
-        /* oppositeDirection = the opposite direction of dir */
-        /* if neighbor has a connection c (door or wall) in direction oppositeDirection: */
-        /* store c in r at direction dir */
-        /* store a wall in r at direction dir */
+        for(c = 0; c < columns; c += 2)
+            packed[c / 2] = hex[c] << 4 | (c + 1 < columns ? hex[c + 1] : ALLWALLS);
+        writeMazeRow(&w, format, packed, columns);
+
+        if(lastRow)
+            break;
+        /* rooms opened from above keep their set, renumbered into 0..columns-1; the rest start new sets */
+        unsigned int nextId = 0;
+        for(c = 0; c < columns; c++)
+        {
+            if(hex[c] & SOUTHHEX)
+            {
+                set[c] = nextId++;
+                hex[c] = ALLWALLS;
+            }
+            else
+            {
+                if(label[set[c]] == (unsigned int)columns)
+                    label[set[c]] = nextId++;
+                set[c] = label[set[c]];
+                hex[c] = ALLWALLS & ~NORTHHEX;
+            }
+        }
+    }
+    if(closeMazeWriter(&w) == 0)
+    {
+        fprintf(stderr, "Error writing %s\n", fileName);
+        exit(1);
     }
+    ok = 1;
+
+done:
+    free(set);
+    free(parent);
+    free(count);
+    free(label);
+    free(southOpen);
+    free(hex);
+    free(packed);
+    return ok;
+}
+
+/* Function defaultSeed
+
+   Picks a seed when none is given on the command line. Mixes the time in
+   nanoseconds with the process id, so runs started in the same second differ.
+
+   Input: Void
+
+   Output: A 64-bit seed
+*/
+uint64_t defaultSeed(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t x = (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+    x ^= (uint64_t)getpid() << 32;
+    return splitmix64(&x);
 }
@@ -0,0 +1,325 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "mazecheck.h"
+#include "parallel.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* A byte repeated in every byte of a word */
+#define EVERY_BYTE(b) (0x0101010101010101ull * (b))
+
+/* A check shared by its workers, which take bands of rows from nextBand and
+   each count into their own mazeCheck. Every room has a parent in a union
+   find forest, always a room with a lower number, so the forest has no
+   cycle however the workers interleave; links counts the parents set. */
+struct wallCheck {
+    const struct maze *m;
+    int bands;
+    atomic_int nextBand;
+    struct mazeCheck *counts;   /* one per worker */
+    uint64_t *links;            /* one per worker */
+    _Atomic uint32_t *parents;
+};
+
+/* Function loadWord
+
+   Reads 8 bytes of cells as a word, the first byte lowest, wherever they lie
+
+   Input: *cells - the first byte
+
+   Output: The word
+*/
+static inline uint64_t loadWord(const unsigned char *cells) {
+    uint64_t word;
+    memcpy(&word, cells, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+#ifdef __SSE2__
+/* Function countBlockMismatches
+
+   Counts the walls of 16 bytes of a row of cells, 32 rooms, that disagree
+   with their neighbour's with SSE2, shifting and comparing them as the words
+   of countRowMismatches are. There are no byte shifts, but every bit kept
+   after a shift of 16-bit lanes comes from the same byte, so those serve;
+   each wall bit kept is then set across its byte to be gathered by movemask.
+
+   Input: *cells - the first byte, with at least 17 bytes of the row from it
+          *below - the same byte of the row below, or NULL for the last row
+          *eastWest, *southNorth - the mismatches to add to
+
+   Output: Void
+*/
+static inline void countBlockMismatches(const unsigned char *cells, const unsigned char *below,
+                                        uint64_t *eastWest, uint64_t *southNorth) {
+    const __m128i oddWest = _mm_set1_epi8(0x04);
+    const __m128i nextWest = _mm_set1_epi8(0x08);
+    __m128i block = _mm_loadu_si128((const __m128i *)cells);
+    __m128i next = _mm_loadu_si128((const __m128i *)(cells + 1));
+    __m128i odd = _mm_and_si128(_mm_xor_si128(_mm_srli_epi16(block, 5), block), oddWest);
+    __m128i even = _mm_and_si128(_mm_xor_si128(_mm_srli_epi16(next, 3), block), nextWest);
+    *eastWest += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(odd, oddWest)));
+    *eastWest += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(even, nextWest)));
+    if(below != NULL)
+    {
+        const __m128i evenNorth = _mm_set1_epi8(0x10);
+        const __m128i oddNorth = _mm_set1_epi8(0x01);
+        __m128i south = _mm_xor_si128(_mm_srli_epi16(block, 1), _mm_loadu_si128((const __m128i *)below));
+        *southNorth += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(south, evenNorth), evenNorth)));
+        *southNorth += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(south, oddNorth), oddNorth)));
+    }
+}
+#endif
+
+/* Function countRowMismatches
+
+   Counts the walls of a row of rooms that disagree with their neighbour's,
+   16 rooms to a 64-bit word. In a cell byte the even room's east wall (0x80)
+   meets the odd room's west wall (0x04), the odd room's east wall (0x08) the
+   next byte's west wall (0x40), and each south wall (0x20, 0x02) the north
+   wall one bit lower in the row below, so a shift and an exclusive or lines up
+   a whole word of walls with the walls they must match. With SSE2 the row is
+   compared 16 bytes at a time first. The last bytes of a row, which may hold
+   a padding nibble, are compared one at a time.
+
+   Input: *m - the maze
+          row - the row
+          *count - the check to add the mismatches to
+
+   Output: Void
+*/
+static void countRowMismatches(const struct maze *m, int row, struct mazeCheck *count) {
+    const unsigned char *cells = m->cells + (size_t)row * m->stride;
+    const unsigned char *below = row + 1 < m->rows ? cells + m->stride : NULL;
+    size_t bytes = ((size_t)m->columns + 1) / 2, j = 0;
+    uint64_t eastWest = 0, southNorth = 0;
+#ifdef __SSE2__
+    for(; j + 17 <= bytes; j += 16)
+        countBlockMismatches(cells + j, below != NULL ? below + j : NULL, &eastWest, &southNorth);
+#endif
+    for(; j + 9 <= bytes; j += 8)
+    {
+        uint64_t word = loadWord(cells + j);
+        eastWest += __builtin_popcountll(((word >> 5) ^ word) & EVERY_BYTE(0x04));
+        eastWest += __builtin_popcountll(((loadWord(cells + j + 1) >> 3) ^ word) & EVERY_BYTE(0x08));
+        if(below != NULL)
+            southNorth += __builtin_popcountll(((word >> 1) ^ loadWord(below + j)) & EVERY_BYTE(0x11));
+    }
+    for(; j < bytes; j++)
+    {
+        unsigned int cell = cells[j];
+        int oddRoom = 2 * j + 1 < (size_t)m->columns;
+        if(oddRoom)
+            eastWest += (((cell >> 5) ^ cell) & 0x04) != 0;
+        if(2 * j + 2 < (size_t)m->columns)
+            eastWest += (((cells[j + 1] >> 3) ^ cell) & 0x08) != 0;
+        if(below != NULL)
+            southNorth += __builtin_popcount(((cell >> 1) ^ below[j]) & (oddRoom ? 0x11 : 0x10));
+    }
+    count->eastWestMismatches += eastWest;
+    count->southNorthMismatches += southNorth;
+}
+
+/* Function countOpenBorder
+
+   Counts the sides of the rooms of a row that open onto the outside
+
+   Input: *m - the maze
+          row - the row
+          *count - the check to add the open sides to
+
+   Output: Void
+*/
+static void countOpenBorder(const struct maze *m, int row, struct mazeCheck *count) {
+    int column;
+    count->openBorderSides += !(roomHexValue(m, row, 0) & WESTHEX);
+    count->openBorderSides += !(roomHexValue(m, row, m->columns - 1) & EASTHEX);
+    if(row == 0)
+        for(column = 0; column < m->columns; column++)
+            count->openBorderSides += !(roomHexValue(m, row, column) & NORTHHEX);
+    if(row + 1 == m->rows)
+        for(column = 0; column < m->columns; column++)
+            count->openBorderSides += !(roomHexValue(m, row, column) & SOUTHHEX);
+}
+
+/* Function checkRows
+
+   Worker checking the walls of the rows of the bands it takes and starting
+   their union find forest: each run of rooms joined east to west has the
+   first room of the run as the parent of the others, so a room's root in
+   its row is a step away. The passages of the rows are counted here too.
+
+   Input: *arg - the wallCheck
+          id - the worker number, which picks its check
+
+   Output: Void
+*/
+static void checkRows(void *arg, int id) {
+    struct wallCheck *c = arg;
+    const struct maze *m = c->m;
+    struct mazeCheck *count = &c->counts[id];
+    uint64_t links = 0;
+    int band;
+    while((band = atomic_fetch_add_explicit(&c->nextBand, 1, memory_order_relaxed)) < c->bands)
+    {
+        int row, lastRow = (band + 1) * PARALLEL_BAND_ROWS < m->rows ? (band + 1) * PARALLEL_BAND_ROWS : m->rows;
+        for(row = band * PARALLEL_BAND_ROWS; row < lastRow; row++)
+        {
+            countRowMismatches(m, row, count);
+            countOpenBorder(m, row, count);
+            uint32_t room = (uint32_t)row * m->columns, runStart = room;
+            unsigned int westOpen = 0;
+            int column;
+            for(column = 0; column < m->columns; column++, room++)
+            {
+                unsigned int hexValue = roomHexValue(m, row, column);
+                if(!westOpen)
+                    runStart = room;
+                atomic_store_explicit(&c->parents[room], runStart, memory_order_relaxed);
+                links += westOpen;
+                westOpen = column + 1 < m->columns && !(hexValue & EASTHEX);
+                count->passages += westOpen + (row + 1 < m->rows && !(hexValue & SOUTHHEX));
+            }
+        }
+    }
+    c->links[id] = links;
+}
+
+/* Function findRoot
+
+   Finds the root of a room in a union find forest, halving the path on the
+   way. A room that is not a root only ever moves to an ancestor, so another
+   worker's halving or linking never makes the path wrong.
+
+   Input: *parents - the parent of every room
+          room - the room
+
+   Output: The room number of its root
+*/
+static inline uint32_t findRoot(_Atomic uint32_t *parents, uint32_t room) {
+    for(;;)
+    {
+        uint32_t parent = atomic_load_explicit(&parents[room], memory_order_relaxed);
+        if(parent == room)
+            return room;
+        uint32_t grandparent = atomic_load_explicit(&parents[parent], memory_order_relaxed);
+        if(grandparent != parent)
+            atomic_store_explicit(&parents[room], grandparent, memory_order_relaxed);
+        room = grandparent;
+    }
+}
+
+/* Function joinRows
+
+   Worker joining each room of the bands it takes to the room south of it
+   when the passage between them is open. The root with the higher number
+   is linked under the other, and only if it is still a root, so a link lost
+   to another worker is retried from the new roots.
+
+   Input: *arg - the wallCheck
+          id - the worker number, which picks its link count
+
+   Output: Void
+*/
+static void joinRows(void *arg, int id) {
+    struct wallCheck *c = arg;
+    const struct maze *m = c->m;
+    _Atomic uint32_t *parents = c->parents;
+    uint64_t links = 0;
+    int band;
+    while((band = atomic_fetch_add_explicit(&c->nextBand, 1, memory_order_relaxed)) < c->bands)
+    {
+        int row, lastRow = (band + 1) * PARALLEL_BAND_ROWS < m->rows ? (band + 1) * PARALLEL_BAND_ROWS : m->rows;
+        if(lastRow == m->rows)
+            lastRow--;
+        for(row = band * PARALLEL_BAND_ROWS; row < lastRow; row++)
+        {
+            uint32_t room = (uint32_t)row * m->columns;
+            int column;
+            for(column = 0; column < m->columns; column++, room++)
+            {
+                if(roomHexValue(m, row, column) & SOUTHHEX)
+                    continue;
+                uint32_t a = room, b = room + m->columns;
+                for(;;)
+                {
+                    a = findRoot(parents, a);
+                    b = findRoot(parents, b);
+                    if(a == b)
+                        break;
+                    uint32_t high = a > b ? a : b, low = a > b ? b : a;
+                    if(atomic_compare_exchange_weak_explicit(&parents[high], &high, low,
+                                                             memory_order_relaxed, memory_order_relaxed))
+                    {
+                        links++;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    c->links[id] += links;
+}
+
+/* Function checkMaze
+
+   Checks a maze in two passes over bands of rows on every worker. The first
+   compares walls a word at a time, counts passages and links each room to
+   an open west neighbour; the second joins rooms across open south sides in
+   a lock-free union find. Every link joins two components, so the number of
+   components and cycles follows from the links without a further pass.
+
+   Input: *m - the maze
+          threads - the number of workers, 0 for every processor
+          *check - set to what the check found
+
+   Output: 1 if the maze was checked and 0 if out of memory or the maze is too large
+*/
+int checkMaze(const struct maze *m, int threads, struct mazeCheck *check) {
+    size_t rooms = (size_t)m->rows * m->columns;
+    memset(check, 0, sizeof(*check));
+    if(rooms > UINT32_MAX)
+        return 0;
+    struct wallCheck c;
+    c.m = m;
+    c.bands = (m->rows + PARALLEL_BAND_ROWS - 1) / PARALLEL_BAND_ROWS;
+    if(threads <= 0)
+        threads = defaultThreadCount();
+    if(threads > c.bands)
+        threads = c.bands;
+    c.counts = calloc(threads, sizeof(struct mazeCheck));
+    c.links = calloc(threads, sizeof(uint64_t));
+    c.parents = malloc(rooms * sizeof(uint32_t));
+    int ok = c.counts != NULL && c.links != NULL && c.parents != NULL;
+    atomic_init(&c.nextBand, 0);
+    ok = ok && runParallel(threads, checkRows, &c);
+    atomic_init(&c.nextBand, 0);
+    ok = ok && runParallel(threads, joinRows, &c);
+    if(ok)
+    {
+        uint64_t links = 0;
+        int i;
+        for(i = 0; i < threads; i++)
+        {
+            check->eastWestMismatches += c.counts[i].eastWestMismatches;
+            check->southNorthMismatches += c.counts[i].southNorthMismatches;
+            check->openBorderSides += c.counts[i].openBorderSides;
+            check->passages += c.counts[i].passages;
+            links += c.links[i];
+        }
+        check->rooms = rooms;
+        check->components = rooms - links;
+        check->cycles = check->passages - links;
+        check->perfect = check->eastWestMismatches == 0 && check->southNorthMismatches == 0 &&
+                         check->openBorderSides == 0 && check->components == 1 && check->cycles == 0;
+    }
+    free(c.counts);
+    free(c.links);
+    free((void *)c.parents);
+    return ok;
+}
@@ -0,0 +1,27 @@
+#ifndef MAZECHECK_H
+#define MAZECHECK_H
+
+#include "common.h"
+
+/* What a check of a maze found. Walls agree when every room's east wall
+   matches its east neighbour's west wall and its south wall its south
+   neighbour's north wall, and the border of the maze is closed. Passages are
+   the open east and south sides of rooms inside the maze, taken from the room
+   to the west or north when walls disagree. A maze is perfect when its walls
+   agree and its passages join every room by exactly one path: one component
+   and no cycle. */
+struct mazeCheck {
+    uint64_t rooms;
+    uint64_t eastWestMismatches;    /* east walls that differ from the west wall of the next room */
+    uint64_t southNorthMismatches;  /* south walls that differ from the north wall of the next room */
+    uint64_t openBorderSides;       /* sides open onto the outside of the maze */
+    uint64_t passages;
+    uint64_t components;    /* sets of rooms joined by passages */
+    uint64_t cycles;        /* passages beyond a spanning forest, passages - rooms + components */
+    int perfect;
+};
+
+/* Checks the walls, connectivity and cycles of a maze on a number of threads */
+int checkMaze(const struct maze *m, int threads, struct mazeCheck *check);
+
+#endif
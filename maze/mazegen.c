@@ -0,0 +1,375 @@
+#include <stdlib.h>
+#include <string.h>
+#include "mazegen.h"
+
+/* A frame of the drunken walk stack, packed into 16 bits: bits 0-7 hold the
+   random direction order (2 bits per direction), bits 8-10 the index of the
+   next direction to try, and bits 11-12 the direction walked to enter the room.
+   The room itself is not stored; backtracking steps opposite the entry direction. */
+typedef unsigned short walkFrame;
+
+#define FRAME_DIRECTION(f, i) (((f) >> (2 * (i))) & 3)
+#define FRAME_NEXT(f) (((f) >> 8) & 7)
+#define FRAME_ENTRY(f) (((f) >> 11) & 3)
+#define MAKE_FRAME(order, next, entry) ((walkFrame)((order) | ((next) << 8) | ((entry) << 11)))
+
+/* All 24 orders of the four directions, packed as in a walkFrame */
+static const unsigned char directionOrders[24] = {
+    0xe4, 0xb4, 0xd8, 0x78, 0x9c, 0x6c, 0xe1, 0xb1, 0xc9, 0x39, 0x8d, 0x2d,
+    0xd2, 0x72, 0xc6, 0x36, 0x4e, 0x1e, 0x93, 0x63, 0x87, 0x27, 0x4b, 0x1b
+};
+
+/* Initial number of frames reserved for the drunken walk stack */
+#define WALK_STACK_INITIAL 1024
+
+const struct genEngine genEngines[] = {
+    {"drunkenwalk", "depth first random walk, long corridors", drunkenWalkAlgorithm},
+    {"kruskal", "shuffled edges joined by union-find", kruskalAlgorithm},
+    {"wilson", "loop-erased random walks, uniform spanning tree", wilsonAlgorithm},
+    {"binarytree", "each room opens north or west", binaryTreeAlgorithm},
+    {"sidewinder", "east runs that each open north once", sidewinderAlgorithm},
+    {NULL, NULL, NULL}
+};
+
+/* Function findGenEngine
+
+   Looks up a generation algorithm by name
+
+   Input: *name - the name of the algorithm
+
+   Output: The algorithm, or NULL if there is none by that name
+*/
+const struct genEngine *findGenEngine(const char *name) {
+    const struct genEngine *e;
+    for(e = genEngines; e->name != NULL; e++)
+    {
+        if(strcmp(e->name, name) == 0)
+            return e;
+    }
+    return NULL;
+}
+
+/* Function growScratch
+
+   Grows scratch memory to at least a number of bytes, keeping its contents.
+   Memory is at least doubled so repeated growth stays linear.
+
+   Input: *scratch - the scratch memory
+          bytes - the number of bytes needed
+
+   Output: The scratch memory, or NULL if it could not grow
+*/
+void *growScratch(struct genScratch *scratch, size_t bytes) {
+    if(bytes <= scratch->capacity)
+        return scratch->memory;
+    size_t capacity = 2 * scratch->capacity;
+    if(capacity < bytes)
+        capacity = bytes;
+    void *memory = realloc(scratch->memory, capacity);
+    if(memory == NULL)
+        return NULL;
+    scratch->memory = memory;
+    scratch->capacity = capacity;
+    return memory;
+}
+
+/* Function freeScratch
+
+   Releases scratch memory
+
+   Input: *scratch - the scratch memory
+
+   Output: Void
+*/
+void freeScratch(struct genScratch *scratch) {
+    free(scratch->memory);
+    scratch->memory = NULL;
+    scratch->capacity = 0;
+}
+
+/* Function inRegion
+
+   Determines whether a room lies inside a region
+
+   Input: *region - the region
+          row, column - the room
+
+   Output: 1 if the room is in the region and 0 otherwise
+*/
+static inline int inRegion(const struct region *region, int row, int column) {
+    return !roomOutOfBounds(row - region->top, column - region->left, region->columns, region->rows);
+}
+
+/* Function drunkenWalkAlgorithm
+
+   Performs the drunken walk algorithm on a region of a maze, starting from its
+   top left room. The walk is iterative: each room on the current path is a
+   16-bit walkFrame on a stack in scratch memory that grows as needed, so the
+   walk depth is bounded by memory rather than by ulimit -s.
+
+   Input: *m - the maze to perform drunken walk on
+          *region - the rooms the walk may visit
+          *scratch - holds the walk stack
+          *rng - the random number generator
+
+   Output: 1 on success and 0 if the walk stack could not be allocated
+*/
+int drunkenWalkAlgorithm(struct maze *m, const struct region *region, struct genScratch *scratch, struct rng *rng) {
+    walkFrame *stack = growScratch(scratch, WALK_STACK_INITIAL * sizeof(walkFrame));
+    if(stack == NULL)
+        return 0;
+    size_t capacity = scratch->capacity / sizeof(walkFrame);
+    size_t depth = 0;
+    int row = region->top, column = region->left;
+
+    /* create random order of directions for the starting room */
+    markRoomVisited(m, row, column);
+    stack[depth++] = MAKE_FRAME(directionOrders[rngBounded(rng, 24)], 0, 0);
+
+    while(depth > 0)
+    {
+        walkFrame *top = &stack[depth - 1];
+        int next = FRAME_NEXT(*top);
+
+        /* every direction tried: backtrack to the room we entered from */
+        if(next == 4)
+        {
+            if(--depth > 0)
+            {
+                int back = OPPOSITE_DIRECTION(FRAME_ENTRY(*top));
+                row += SouthNorthOffset[back];
+                column += EastWestOffset[back];
+            }
+            continue;
+        }
+        int dir = FRAME_DIRECTION(*top, next);
+        *top = MAKE_FRAME(*top & 0xff, next + 1, FRAME_ENTRY(*top));
+
+        /* if neighbor is in the region and has not yet been visited,
+           open the connection to it and walk into the neighbor */
+        int tempR = row + SouthNorthOffset[dir];
+        int tempC = column + EastWestOffset[dir];
+        if(!inRegion(region, tempR, tempC) || roomVisited(m, tempR, tempC))
+            continue;
+        openRoomConnection(m, row, column, dir);
+        if(depth == capacity)
+        {
+            stack = growScratch(scratch, 2 * capacity * sizeof(walkFrame));
+            if(stack == NULL)
+                return 0;
+            capacity = scratch->capacity / sizeof(walkFrame);
+        }
+        row = tempR;
+        column = tempC;
+        markRoomVisited(m, row, column);
+        stack[depth++] = MAKE_FRAME(directionOrders[rngBounded(rng, 24)], 0, dir);
+    }
+    return 1;
+}
+
+/* Function findRoot
+
+   Finds the representative of a room in a union-find forest, halving the path
+   on the way up
+
+   Input: *parent - the union-find parent of each room
+          id - the room to look up
+
+   Output: The representative room
+*/
+static inline uint32_t findRoot(uint32_t *parent, uint32_t id) {
+    while(parent[id] != id)
+    {
+        parent[id] = parent[parent[id]];
+        id = parent[id];
+    }
+    return id;
+}
+
+/* Function kruskalAlgorithm
+
+   Performs randomized Kruskal on a region. Every interior wall is an entry in
+   one flat edge array (room * 2, plus 1 for the south wall rather than the
+   east one), shuffled once. Walls are then opened in that order whenever they
+   separate two sets of a path-halving union-find, stopping once the region is
+   a single set. Needs 12 bytes of scratch per room and at most 2^31 rooms.
+
+   Input: *m - the maze to generate in
+          *region - the rooms to connect
+          *scratch - holds the edge array and the union-find
+          *rng - the random number generator
+
+   Output: 1 on success and 0 if scratch memory could not be allocated
+*/
+int kruskalAlgorithm(struct maze *m, const struct region *region, struct genScratch *scratch, struct rng *rng) {
+    size_t rooms = (size_t)region->rows * region->columns;
+    size_t edges = (size_t)region->rows * (region->columns - 1) + (size_t)(region->rows - 1) * region->columns;
+    if(rooms > INT32_MAX)
+        return 0;
+    uint32_t *edge = growScratch(scratch, (edges + rooms) * sizeof(uint32_t));
+    if(edge == NULL)
+        return 0;
+    uint32_t *parent = edge + edges;
+
+    size_t n = 0;
+    uint32_t i;
+    for(i = 0; i < rooms; i++)
+    {
+        parent[i] = i;
+        if(i % region->columns != (uint32_t)region->columns - 1)
+            edge[n++] = 2 * i;
+        if(i / region->columns != (uint32_t)region->rows - 1)
+            edge[n++] = 2 * i + 1;
+    }
+    for(n = edges; n > 1; n--)
+    {
+        uint32_t j = rngBounded(rng, n);
+        uint32_t t = edge[n - 1];
+        edge[n - 1] = edge[j];
+        edge[j] = t;
+    }
+
+    size_t joined = 0;
+    for(n = 0; n < edges && joined + 1 < rooms; n++)
+    {
+        uint32_t room = edge[n] >> 1;
+        int dir = (edge[n] & 1) ? SOUTH : EAST;
+        uint32_t neighbor = room + ((dir == SOUTH) ? (uint32_t)region->columns : 1);
+        uint32_t a = findRoot(parent, room);
+        uint32_t b = findRoot(parent, neighbor);
+        if(a == b)
+            continue;
+        parent[a] = b;
+        joined++;
+        openRoomConnection(m, region->top + room / region->columns, region->left + room % region->columns, dir);
+    }
+    return 1;
+}
+
+/* Function wilsonAlgorithm
+
+   Performs Wilson's algorithm on a region, which picks each spanning tree with
+   equal probability. The tree starts as one random room. From every room not
+   yet in the tree, a random walk runs until it reaches the tree, recording in
+   scratch the direction it last left each room by; following those directions
+   from the start retraces the walk with its loops erased, and that path joins
+   the tree. The visited bitmap marks rooms in the tree.
+
+   Input: *m - the maze to generate in
+          *region - the rooms to connect
+          *scratch - holds the last exit direction of each room
+          *rng - the random number generator
+
+   Output: 1 on success and 0 if scratch memory could not be allocated
+*/
+int wilsonAlgorithm(struct maze *m, const struct region *region, struct genScratch *scratch, struct rng *rng) {
+    unsigned char *exit = growScratch(scratch, (size_t)region->rows * region->columns);
+    if(exit == NULL)
+        return 0;
+    markRoomVisited(m, region->top + rngBounded(rng, region->rows), region->left + rngBounded(rng, region->columns));
+
+    int r, c;
+    for(r = region->top; r < region->top + region->rows; r++)
+    {
+        for(c = region->left; c < region->left + region->columns; c++)
+        {
+            int row = r, column = c;
+            /* random walk until the tree is reached */
+            while(!roomVisited(m, row, column))
+            {
+                int dir, tempR, tempC;
+                do
+                {
+                    dir = rngBounded(rng, 4);
+                    tempR = row + SouthNorthOffset[dir];
+                    tempC = column + EastWestOffset[dir];
+                } while(!inRegion(region, tempR, tempC));
+                exit[(size_t)(row - region->top) * region->columns + (column - region->left)] = dir;
+                row = tempR;
+                column = tempC;
+            }
+            /* retrace the loop-erased walk into the tree */
+            row = r;
+            column = c;
+            while(!roomVisited(m, row, column))
+            {
+                int dir = exit[(size_t)(row - region->top) * region->columns + (column - region->left)];
+                markRoomVisited(m, row, column);
+                openRoomConnection(m, row, column, dir);
+                row += SouthNorthOffset[dir];
+                column += EastWestOffset[dir];
+            }
+        }
+    }
+    return 1;
+}
+
+/* Function binaryTreeAlgorithm
+
+   Performs the binary tree algorithm on a region: every room opens either
+   north or west at random, or whichever of the two stays in the region. Rooms
+   are independent of each other, so the pass needs no memory and rows could
+   be generated in any order.
+
+   Input: *m - the maze to generate in
+          *region - the rooms to connect
+          *scratch - unused
+          *rng - the random number generator
+
+   Output: 1
+*/
+int binaryTreeAlgorithm(struct maze *m, const struct region *region, struct genScratch *scratch, struct rng *rng) {
+    int r, c;
+    (void)scratch;
+    for(r = region->top; r < region->top + region->rows; r++)
+    {
+        for(c = region->left; c < region->left + region->columns; c++)
+        {
+            int canNorth = r > region->top, canWest = c > region->left;
+            if(canNorth && (!canWest || rngBit(rng)))
+                openRoomConnection(m, r, c, NORTH);
+            else if(canWest)
+                openRoomConnection(m, r, c, WEST);
+        }
+    }
+    return 1;
+}
+
+/* Function sidewinderAlgorithm
+
+   Performs the sidewinder algorithm on a region. The first row is one east
+   corridor. Every other row is cut into runs of rooms opened east, closed at
+   random, and each run opens north from one random room. A row depends only
+   on itself, so the pass needs no memory.
+
+   Input: *m - the maze to generate in
+          *region - the rooms to connect
+          *scratch - unused
+          *rng - the random number generator
+
+   Output: 1
+*/
+int sidewinderAlgorithm(struct maze *m, const struct region *region, struct genScratch *scratch, struct rng *rng) {
+    int r, c;
+    int right = region->left + region->columns - 1;
+    (void)scratch;
+    for(c = region->left; c < right; c++)
+        openRoomConnection(m, region->top, c, EAST);
+    for(r = region->top + 1; r < region->top + region->rows; r++)
+    {
+        int runStart = region->left;
+        for(c = region->left; c <= right; c++)
+        {
+            if(c == right || rngBit(rng))
+            {
+                openRoomConnection(m, r, runStart + rngBounded(rng, c - runStart + 1), NORTH);
+                runStart = c + 1;
+            }
+            else
+            {
+                openRoomConnection(m, r, c, EAST);
+            }
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,54 @@
+#ifndef MAZEGEN_H
+#define MAZEGEN_H
+
+#include "common.h"
+#include "rng.h"
+
+/* A rectangle of rooms: rows top..top+rows-1 and columns left..left+columns-1 */
+struct region {
+    int top, left, rows, columns;
+};
+
+/* Working memory of a generation algorithm, kept between runs so it is reused */
+struct genScratch {
+    void *memory;
+    size_t capacity;
+};
+
+/* A maze generation algorithm. generate carves a spanning tree of a region of
+   a maze whose rooms start with all walls and are unvisited, never opening a
+   wall out of the region. It returns 0 if its scratch memory could not grow. */
+struct genEngine {
+    const char *name;
+    const char *description;
+    int (*generate)(struct maze *m, const struct region *region, struct genScratch *scratch, struct rng *rng);
+};
+
+/* Every generation algorithm, ending with an entry whose name is NULL */
+extern const struct genEngine genEngines[];
+
+/* Looks up a generation algorithm by name */
+const struct genEngine *findGenEngine(const char *name);
+
+/* Grows scratch memory to at least the given number of bytes */
+void *growScratch(struct genScratch *scratch, size_t bytes);
+
+/* Releases scratch memory */
+void freeScratch(struct genScratch *scratch);
+
+/* Depth first random walk: long winding corridors with few branches */
+int drunkenWalkAlgorithm(struct maze *m, const struct region *region, struct genScratch *scratch, struct rng *rng);
+
+/* Randomized Kruskal over a shuffled edge array with a union-find of rooms */
+int kruskalAlgorithm(struct maze *m, const struct region *region, struct genScratch *scratch, struct rng *rng);
+
+/* Wilson's loop-erased random walks: a uniformly random spanning tree */
+int wilsonAlgorithm(struct maze *m, const struct region *region, struct genScratch *scratch, struct rng *rng);
+
+/* Binary tree: every room opens north or west */
+int binaryTreeAlgorithm(struct maze *m, const struct region *region, struct genScratch *scratch, struct rng *rng);
+
+/* Sidewinder: runs of rooms opened east, each run opening north once */
+int sidewinderAlgorithm(struct maze *m, const struct region *region, struct genScratch *scratch, struct rng *rng);
+
+#endif
@@ -0,0 +1,231 @@
+#include <stdlib.h>
+#include <string.h>
+#include "mazegraph.h"
+
+/* Direction of the single open side in a set of hex bits */
+static const signed char hexDirection[16] = {-1, NORTH, SOUTH, -1, WEST, -1, -1, -1, EAST, -1, -1, -1, -1, -1, -1, -1};
+
+/* Function markJunctions
+
+   Sets the bit of every junction of a maze row by row. A room is a junction
+   unless it has exactly two open sides; an open side out of the maze or a
+   wall that only one of two neighbours has makes a junction too, of both.
+
+   Input: *g - the graph with its bits cleared
+          *m - the maze
+
+   Output: Void
+*/
+static void markJunctions(struct junctionGraph *g, const struct maze *m) {
+    uint64_t *bits = g->bits;
+    uint32_t room = 0;
+    int row, column;
+#define MARK_JUNCTION(r) (bits[(r) >> 6] |= (uint64_t)1 << ((r) & 63))
+    for(row = 0; row < m->rows; row++)
+    {
+        int lastRow = (row + 1 == m->rows);
+        for(column = 0; column < m->columns; column++, room++)
+        {
+            unsigned int hexValue = roomHexValue(m, row, column);
+            if(openSideCount(~hexValue & ALLWALLS) != 2 ||
+               (column == 0 && !(hexValue & WESTHEX)) || (row == 0 && !(hexValue & NORTHHEX)))
+                MARK_JUNCTION(room);
+            if(column + 1 == m->columns)
+            {
+                if(!(hexValue & EASTHEX))
+                    MARK_JUNCTION(room);
+            }
+            else if(!(hexValue & EASTHEX) != !(roomHexValue(m, row, column + 1) & WESTHEX))
+            {
+                MARK_JUNCTION(room);
+                MARK_JUNCTION(room + 1);
+            }
+            if(lastRow)
+            {
+                if(!(hexValue & SOUTHHEX))
+                    MARK_JUNCTION(room);
+            }
+            else if(!(hexValue & SOUTHHEX) != !(roomHexValue(m, row + 1, column) & NORTHHEX))
+            {
+                MARK_JUNCTION(room);
+                MARK_JUNCTION(room + m->columns);
+            }
+        }
+    }
+#undef MARK_JUNCTION
+}
+
+/* Function corridorExit
+
+   Finds the way on through a corridor room
+
+   Input: *m - the maze
+          row, column - the corridor room
+          direction - the direction of the step that entered it
+
+   Output: The direction of its other open side
+*/
+int corridorExit(const struct maze *m, int row, int column, int direction) {
+    unsigned int open = ~roomHexValue(m, row, column) & ALLWALLS;
+    return hexDirection[open & ~DIRECTION_HEX(OPPOSITE_DIRECTION(direction))];
+}
+
+/* Function followCorridor
+
+   Walks from a room through the corridor in a direction, stopping at the
+   first junction, at a given room, or back at the room it started from when
+   that room lies on a loop of corridor rooms with no junction
+
+   Input: *g - the junction graph of the maze
+          *m - the maze
+          room - the room number to start from
+          direction - the direction of the first step, which must be open
+          stop - a room number to stop at
+          *length - set to the number of steps taken
+
+   Output: The room number it stopped at
+*/
+uint32_t followCorridor(const struct junctionGraph *g, const struct maze *m, uint32_t room, int direction,
+                        uint32_t stop, uint32_t *length) {
+    const long step[4] = {1, -1, m->columns, -(long)m->columns};
+    int row = room / m->columns;
+    int column = room - (uint32_t)row * m->columns;
+    uint32_t origin = room;
+    uint32_t steps = 0;
+    for(;;)
+    {
+        room += step[direction];
+        row += SouthNorthOffset[direction];
+        column += EastWestOffset[direction];
+        steps++;
+        if(room == stop || room == origin || isJunctionRoom(g, room))
+            break;
+        direction = corridorExit(m, row, column, direction);
+    }
+    *length = steps;
+    return room;
+}
+
+/* Function buildJunctionGraph
+
+   Contracts the corridors of a maze into a junction graph. One pass marks the
+   junctions, another numbers them; a third follows every open side of every
+   junction along its corridor to the junction at the other end.
+
+   Input: *g - the graph to build
+          *m - the maze
+
+   Output: 1 if the graph was built and -1 if out of memory or the maze is too large
+*/
+int buildJunctionGraph(struct junctionGraph *g, const struct maze *m) {
+    size_t rooms = (size_t)m->rows * m->columns;
+    size_t words = (rooms + 63) / 64;
+    memset(g, 0, sizeof(*g));
+    if(rooms > UINT32_MAX)
+        return -1;
+    g->rows = m->rows;
+    g->columns = m->columns;
+    g->bits = calloc(words, sizeof(uint64_t));
+    g->ranks = malloc(words * sizeof(uint32_t));
+    if(g->bits == NULL || g->ranks == NULL)
+    {
+        destroyJunctionGraph(g);
+        return -1;
+    }
+
+    markJunctions(g, m);
+    uint32_t room;
+    int row, column;
+    size_t w, junctions = 0;
+    for(w = 0; w < words; w++)
+    {
+        g->ranks[w] = junctions;
+        junctions += __builtin_popcountll(g->bits[w]);
+    }
+    g->junctions = junctions;
+    g->rooms = malloc(junctions * sizeof(uint32_t) + 1);
+    g->firstEdges = malloc((junctions + 1) * sizeof(uint32_t));
+    if(g->rooms == NULL || g->firstEdges == NULL)
+    {
+        destroyJunctionGraph(g);
+        return -1;
+    }
+
+    /* number the junctions and count the open sides each has */
+    size_t j = 0, edges = 0;
+    for(w = 0; w < words; w++)
+    {
+        uint64_t word = g->bits[w];
+        while(word != 0)
+        {
+            room = w * 64 + __builtin_ctzll(word);
+            word &= word - 1;
+            row = room / m->columns;
+            column = room - (uint32_t)row * m->columns;
+            unsigned int hexValue = roomHexValue(m, row, column);
+            g->rooms[j] = room;
+            g->firstEdges[j++] = edges;
+            int d;
+            for(d = 0; d < 4; d++)
+            {
+                if(!(hexValue & DIRECTION_HEX(d)) &&
+                   !roomOutOfBounds(row + SouthNorthOffset[d], column + EastWestOffset[d], m->columns, m->rows))
+                    edges++;
+            }
+        }
+    }
+    if(edges > UINT32_MAX)
+    {
+        destroyJunctionGraph(g);
+        return -1;
+    }
+    g->firstEdges[junctions] = edges;
+    g->edges = malloc(edges * sizeof(struct junctionEdge) + 1);
+    g->directions = malloc(edges + 1);
+    if(g->edges == NULL || g->directions == NULL)
+    {
+        destroyJunctionGraph(g);
+        return -1;
+    }
+
+    size_t e = 0;
+    for(j = 0; j < junctions; j++)
+    {
+        room = g->rooms[j];
+        row = room / m->columns;
+        column = room - (uint32_t)row * m->columns;
+        unsigned int hexValue = roomHexValue(m, row, column);
+        int d;
+        for(d = 0; d < 4; d++)
+        {
+            if((hexValue & DIRECTION_HEX(d)) ||
+               roomOutOfBounds(row + SouthNorthOffset[d], column + EastWestOffset[d], m->columns, m->rows))
+                continue;
+            uint32_t length;
+            uint32_t end = followCorridor(g, m, room, d, room, &length);
+            g->edges[e].target = findJunction(g, end);
+            g->edges[e].length = length;
+            g->directions[e] = d;
+            e++;
+        }
+    }
+    return 1;
+}
+
+/* Function destroyJunctionGraph
+
+   Releases the arrays of a junction graph
+
+   Input: *g - the graph to release
+
+   Output: Void
+*/
+void destroyJunctionGraph(struct junctionGraph *g) {
+    free(g->rooms);
+    free(g->bits);
+    free(g->ranks);
+    free(g->firstEdges);
+    free(g->edges);
+    free(g->directions);
+    memset(g, 0, sizeof(*g));
+}
@@ -0,0 +1,65 @@
+#ifndef MAZEGRAPH_H
+#define MAZEGRAPH_H
+
+#include "common.h"
+
+/* Junction number of a room that is not a junction */
+#define NO_JUNCTION UINT32_MAX
+
+/* An edge of a junction graph: its target and length are kept together, as
+   that is all a search reads */
+struct junctionEdge {
+    uint32_t target;        /* junction the edge ends at */
+    uint32_t length;        /* steps along the edge */
+};
+
+/* A maze contracted to its junctions. A corridor room has exactly two open
+   sides, both inside the maze, and agrees with all four of its neighbours
+   about the walls between them; every other room, a dead end or a fork or a
+   room with a one-way wall, is a junction. Each run of corridor rooms between
+   two junctions becomes an edge weighted by its number of steps, so a search
+   only visits junctions, and the rooms of a corridor are walked again from
+   the direction an edge leaves its junction when a path is written out.
+
+   Junctions are numbered in row-major order of their rooms. A bitmap marks
+   them with a count of the junctions before every 64 rooms, so the junction
+   of a room is found by a popcount. The edges leaving junction j are
+   firstEdges[j] up to firstEdges[j + 1]; a corridor appears once from each end. */
+struct junctionGraph {
+    int rows, columns;
+    uint32_t junctions;
+    uint32_t *rooms;        /* room number of each junction */
+    uint64_t *bits;         /* a bit per room, set for junctions */
+    uint32_t *ranks;        /* junctions before each word of bits */
+    uint32_t *firstEdges;   /* junctions + 1 entries */
+    struct junctionEdge *edges;
+    unsigned char *directions; /* direction each edge leaves its junction */
+};
+
+/* Contracts the corridors of a maze into a junction graph */
+int buildJunctionGraph(struct junctionGraph *g, const struct maze *m);
+
+/* Releases a junction graph */
+void destroyJunctionGraph(struct junctionGraph *g);
+
+/* Determines whether a room is a junction */
+static inline int isJunctionRoom(const struct junctionGraph *g, uint32_t room) {
+    return (g->bits[room >> 6] >> (room & 63)) & 1;
+}
+
+/* Junction number of a room, NO_JUNCTION for a corridor room */
+static inline uint32_t findJunction(const struct junctionGraph *g, uint32_t room) {
+    uint64_t word = g->bits[room >> 6];
+    if(!((word >> (room & 63)) & 1))
+        return NO_JUNCTION;
+    return g->ranks[room >> 6] + __builtin_popcountll(word & (((uint64_t)1 << (room & 63)) - 1));
+}
+
+/* Direction of the open side of a corridor room other than the one toward a direction it was entered by */
+int corridorExit(const struct maze *m, int row, int column, int direction);
+
+/* Follows a corridor from a room to the junction or room where it stops */
+uint32_t followCorridor(const struct junctionGraph *g, const struct maze *m, uint32_t room, int direction,
+                        uint32_t stop, uint32_t *length);
+
+#endif
@@ -0,0 +1,277 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mazeindex.h"
+#include "mazeio.h"
+
+/* Parent entry of a room the index build has not reached yet */
+#define INDEX_UNREACHED 0xff
+
+/* Function mazeFileStamp
+
+   Reads the size and modification time of a maze file, which an index
+   records to recognize the maze it was built from
+
+   Input: *mazeFileName - the maze file
+          *size - set to the size of the file
+          *modified - set to its modification time in nanoseconds since the epoch
+
+   Output: 1 if the file was found and 0 otherwise
+*/
+static int mazeFileStamp(const char *mazeFileName, uint64_t *size, int64_t *modified) {
+    struct stat st;
+    if(stat(mazeFileName, &st) != 0)
+        return 0;
+    *size = st.st_size;
+    *modified = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    return 1;
+}
+
+/* Parent of a room in an index, which must not be the root */
+static inline uint32_t parentRoom(const struct mazeIndex *x, uint32_t room) {
+    int d = x->parents[room];
+    return room + EastWestOffset[d] + SouthNorthOffset[d] * x->columns;
+}
+
+/* Function buildMazeIndex
+
+   Builds the index of a perfect maze by breadth first search from room
+   (0, 0). Rooms are reached parents first, so each jump pointer is set from
+   its parent's: it skips as far as the parent's jump did twice over when the
+   two jumps below the parent are the same length, and to the parent otherwise.
+
+   Input: *x - the index to build
+          *m - the maze, which must be connected and free of cycles
+
+   Output: 1 if the index was built, 0 if the maze is not perfect and -1 if out of memory
+*/
+int buildMazeIndex(struct mazeIndex *x, const struct maze *m) {
+    size_t rooms = (size_t)m->rows * m->columns;
+    if(rooms > UINT32_MAX)
+        return -1;
+    x->rows = m->rows;
+    x->columns = m->columns;
+    x->mapping = NULL;
+    x->mappingLength = 0;
+    x->parents = malloc(rooms);
+    x->depths = malloc(rooms * sizeof(uint32_t));
+    x->jumps = malloc(rooms * sizeof(uint32_t));
+    uint32_t *queue = malloc(rooms * sizeof(uint32_t));
+    if(x->parents == NULL || x->depths == NULL || x->jumps == NULL || queue == NULL)
+    {
+        free(queue);
+        destroyMazeIndex(x);
+        return -1;
+    }
+
+    const long step[4] = {1, -1, m->columns, -(long)m->columns};
+    unsigned char *parents = x->parents;
+    uint32_t *depths = x->depths;
+    uint32_t *jumps = x->jumps;
+    size_t head = 0, tail = 0;
+    int perfect = 1;
+    memset(parents, INDEX_UNREACHED, rooms);
+    parents[0] = INDEX_ROOT;
+    depths[0] = 0;
+    jumps[0] = 0;
+    queue[tail++] = 0;
+    while(head < tail && perfect)
+    {
+        uint32_t room = queue[head++];
+        int row = room / m->columns;
+        int column = room - (uint32_t)row * m->columns;
+        unsigned int hexValue = roomHexValue(m, row, column);
+        uint32_t jump = jumps[room];
+        uint32_t childJump = (depths[room] - depths[jump] == depths[jump] - depths[jumps[jump]]) ? jumps[jump] : room;
+        int d;
+        for(d = 0; d < 4; d++)
+        {
+            if((hexValue & DIRECTION_HEX(d)) || d == parents[room] ||
+               roomOutOfBounds(row + SouthNorthOffset[d], column + EastWestOffset[d], m->columns, m->rows))
+                continue;
+            uint32_t next = room + step[d];
+            if(parents[next] != INDEX_UNREACHED)
+            {
+                perfect = 0;
+                break;
+            }
+            parents[next] = OPPOSITE_DIRECTION(d);
+            depths[next] = depths[room] + 1;
+            jumps[next] = childJump;
+            queue[tail++] = next;
+        }
+    }
+    free(queue);
+    if(!perfect || tail < rooms)
+    {
+        destroyMazeIndex(x);
+        return 0;
+    }
+    return 1;
+}
+
+/* Function saveMazeIndex
+
+   Writes an index to a file with the size and modification time of the maze
+   file it was built from, so it can be mapped instead of rebuilt
+
+   Input: *x - the index
+          *fileName - the index file to write
+          *mazeFileName - the maze file the index was built from
+
+   Output: 1 if the index was written and 0 otherwise
+*/
+int saveMazeIndex(const struct mazeIndex *x, const char *fileName, const char *mazeFileName) {
+    struct mazeIndexHeader header;
+    struct mazeWriter w;
+    size_t rooms = (size_t)x->rows * x->columns;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.version = INDEX_FORMAT_VERSION;
+    header.rows = x->rows;
+    header.columns = x->columns;
+    if(mazeFileStamp(mazeFileName, &header.mazeSize, &header.mazeModified) == 0 || openMazeWriter(&w, fileName) == 0)
+        return 0;
+    writeBytes(&w, &header, sizeof(header));
+    writeBytes(&w, x->depths, rooms * sizeof(uint32_t));
+    writeBytes(&w, x->jumps, rooms * sizeof(uint32_t));
+    writeBytes(&w, x->parents, rooms);
+    if(closeMazeWriter(&w) == 0)
+    {
+        unlink(fileName);
+        return 0;
+    }
+    return 1;
+}
+
+/* Function mapMazeIndex
+
+   Maps an index file read-only and sets up an index whose arrays point into
+   the mapping, so nothing is parsed or copied. The index is only used if it
+   was built from the maze file as it is now.
+
+   Input: *x - the index to set up
+          *fileName - the index file
+          *mazeFileName - the maze file the index must belong to
+
+   Output: 1 if the index was mapped and 0 if it is missing, invalid or stale
+*/
+int mapMazeIndex(struct mazeIndex *x, const char *fileName, const char *mazeFileName) {
+    uint64_t mazeSize;
+    int64_t mazeModified;
+    if(mazeFileStamp(mazeFileName, &mazeSize, &mazeModified) == 0)
+        return 0;
+    int fd = open(fileName, O_RDONLY);
+    if(fd < 0)
+        return 0;
+    struct stat st;
+    void *mapping = MAP_FAILED;
+    if(fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(struct mazeIndexHeader))
+        mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+        return 0;
+
+    const struct mazeIndexHeader *header = mapping;
+    size_t length = st.st_size;
+    size_t rooms = (size_t)header->rows * header->columns;
+    if(memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0 || header->version != INDEX_FORMAT_VERSION ||
+       header->rows == 0 || header->columns == 0 || header->rows > INT32_MAX || header->columns > INT32_MAX ||
+       header->mazeSize != mazeSize || header->mazeModified != mazeModified ||
+       length - sizeof(*header) != rooms * (2 * sizeof(uint32_t) + 1))
+    {
+        munmap(mapping, length);
+        return 0;
+    }
+    unsigned char *arrays = (unsigned char *)mapping + sizeof(*header);
+    x->rows = header->rows;
+    x->columns = header->columns;
+    x->depths = (uint32_t *)arrays;
+    x->jumps = (uint32_t *)(arrays + rooms * sizeof(uint32_t));
+    x->parents = arrays + 2 * rooms * sizeof(uint32_t);
+    x->mapping = mapping;
+    x->mappingLength = length;
+    return 1;
+}
+
+/* Function destroyMazeIndex
+
+   Releases the arrays (or the file mapping holding them) of an index
+
+   Input: *x - the index to release
+
+   Output: Void
+*/
+void destroyMazeIndex(struct mazeIndex *x) {
+    if(x->mapping != NULL)
+    {
+        munmap(x->mapping, x->mappingLength);
+    }
+    else
+    {
+        free(x->parents);
+        free(x->depths);
+        free(x->jumps);
+    }
+    x->parents = NULL;
+    x->depths = NULL;
+    x->jumps = NULL;
+    x->mapping = NULL;
+}
+
+/* Function indexAncestor
+
+   Finds the lowest common ancestor of two rooms. The deeper room first climbs
+   to the depth of the other, taking its jump whenever that does not overshoot.
+   Rooms at equal depth have jumps of equal length, so the two then climb
+   together, jumping while their jumps land on different rooms and otherwise
+   stepping to their parents. Both climbs take O(log n) steps.
+
+   Input: *x - the index
+          a, b - the room numbers
+
+   Output: The room number of their lowest common ancestor
+*/
+uint32_t indexAncestor(const struct mazeIndex *x, uint32_t a, uint32_t b) {
+    const uint32_t *depths = x->depths;
+    const uint32_t *jumps = x->jumps;
+    if(depths[a] < depths[b])
+    {
+        uint32_t t = a;
+        a = b;
+        b = t;
+    }
+    while(depths[a] > depths[b])
+        a = (depths[jumps[a]] >= depths[b]) ? jumps[a] : parentRoom(x, a);
+    while(a != b)
+    {
+        if(jumps[a] != jumps[b])
+        {
+            a = jumps[a];
+            b = jumps[b];
+        }
+        else
+        {
+            a = parentRoom(x, a);
+            b = parentRoom(x, b);
+        }
+    }
+    return a;
+}
+
+/* Function indexDistance
+
+   Counts the steps on the path between two rooms from their depths and the
+   depth of their lowest common ancestor
+
+   Input: *x - the index
+          a, b - the room numbers
+
+   Output: The number of steps between the rooms
+*/
+uint32_t indexDistance(const struct mazeIndex *x, uint32_t a, uint32_t b) {
+    return x->depths[a] + x->depths[b] - 2 * x->depths[indexAncestor(x, a, b)];
+}
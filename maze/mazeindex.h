@@ -0,0 +1,57 @@
+#ifndef MAZEINDEX_H
+#define MAZEINDEX_H
+
+#include "common.h"
+
+/* Identifies maze index files */
+#define INDEX_MAGIC "MAZI"
+#define INDEX_FORMAT_VERSION 1
+
+/* Parent entry of the root room of an index */
+#define INDEX_ROOT 4
+
+/* An index of a perfect maze rooted at room (0, 0), answering lowest common
+   ancestor queries in O(log n). Every room records the direction of its
+   parent, its depth and a jump pointer to an ancestor: jumps follow the
+   skew-binary pattern of Myers' jump pointers, so any ancestor is reached in
+   O(log n) steps with 9 bytes per room and no per-level tables. */
+struct mazeIndex {
+    int rows, columns;
+    unsigned char *parents; /* direction of each room's parent, INDEX_ROOT at the root */
+    uint32_t *depths;
+    uint32_t *jumps;
+    void *mapping;          /* index file the arrays live in, NULL if allocated */
+    size_t mappingLength;
+};
+
+/* Header of a maze index file, followed by the depths, jumps and parents of
+   every room in row-major order. The size and modification time of the maze
+   file it was built from tell a stale index from a current one. */
+struct mazeIndexHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t rows;
+    uint32_t columns;
+    uint64_t mazeSize;
+    int64_t mazeModified;   /* nanoseconds since the epoch */
+};
+
+/* Builds the index of a perfect maze */
+int buildMazeIndex(struct mazeIndex *x, const struct maze *m);
+
+/* Writes an index to a file, recording the maze file it belongs to */
+int saveMazeIndex(const struct mazeIndex *x, const char *fileName, const char *mazeFileName);
+
+/* Maps an index file if it is current for a maze file */
+int mapMazeIndex(struct mazeIndex *x, const char *fileName, const char *mazeFileName);
+
+/* Releases an index */
+void destroyMazeIndex(struct mazeIndex *x);
+
+/* Lowest common ancestor of two rooms */
+uint32_t indexAncestor(const struct mazeIndex *x, uint32_t a, uint32_t b);
+
+/* Number of steps on the path between two rooms */
+uint32_t indexDistance(const struct mazeIndex *x, uint32_t a, uint32_t b);
+
+#endif
@@ -0,0 +1,652 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mazeio.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* The two hex digits of every cell byte, high nibble (even column) first */
+#define HEX_PAIRS(high) \
+    {high,'0'}, {high,'1'}, {high,'2'}, {high,'3'}, {high,'4'}, {high,'5'}, {high,'6'}, {high,'7'}, \
+    {high,'8'}, {high,'9'}, {high,'a'}, {high,'b'}, {high,'c'}, {high,'d'}, {high,'e'}, {high,'f'}
+static const char hexPairs[256][2] = {
+    HEX_PAIRS('0'), HEX_PAIRS('1'), HEX_PAIRS('2'), HEX_PAIRS('3'),
+    HEX_PAIRS('4'), HEX_PAIRS('5'), HEX_PAIRS('6'), HEX_PAIRS('7'),
+    HEX_PAIRS('8'), HEX_PAIRS('9'), HEX_PAIRS('a'), HEX_PAIRS('b'),
+    HEX_PAIRS('c'), HEX_PAIRS('d'), HEX_PAIRS('e'), HEX_PAIRS('f')
+};
+
+/* Value of every byte as a hex digit, HEX_DIGIT_INVALID for bytes that are not one */
+#define HEX_DIGIT_INVALID 0xf0
+static const unsigned char hexDigitValues[256] = {
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0,
+    0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0
+};
+
+/* Bytes of a 64-bit word with every byte set to x */
+#define BYTES(x) (0x0101010101010101ull * (x))
+
+/* High bit of every byte of w that lies strictly between m and n, for bytes below 0x80 */
+#define BYTES_BETWEEN(w, m, n) \
+    ((BYTES(127 + (n)) - ((w) & BYTES(127))) & ~(w) & (((w) & BYTES(127)) + BYTES(127 - (m))) & BYTES(128))
+
+/* Function decodeHexWord
+
+   Decodes 8 hex digits into 4 packed cell bytes at once, treating the digits
+   as one little-endian 64-bit word. Each byte is checked against the digit
+   ranges; its value is the low nibble plus 9 for letters, which have bit 6 set.
+
+   Input: *digits - 8 characters
+          *cells - where to store the 4 cell bytes, first digit in the high nibble
+
+   Output: 1 if all 8 characters were hex digits and 0 otherwise
+*/
+static inline int decodeHexWord(const unsigned char *digits, unsigned char *cells) {
+    uint64_t w;
+    memcpy(&w, digits, sizeof(w));
+    uint64_t valid = BYTES_BETWEEN(w, '0' - 1, '9' + 1) | BYTES_BETWEEN(w, 'a' - 1, 'f' + 1) |
+                     BYTES_BETWEEN(w, 'A' - 1, 'F' + 1);
+    uint64_t v = (w & BYTES(0x0f)) + 9 * ((w >> 6) & BYTES(1));
+    v = ((v << 4) | (v >> 8)) & 0x00ff00ff00ff00ffull;
+    v = (v | (v >> 8)) & 0x0000ffff0000ffffull;
+    uint32_t packed = (uint32_t)(v | (v >> 16));
+    memcpy(cells, &packed, sizeof(packed));
+    return valid == BYTES(128);
+}
+
+#ifdef __SSE2__
+/* Function decodeHexBlock
+
+   Decodes 32 hex digits into 16 packed cell bytes with SSE2. Each digit's
+   value is its low nibble plus 9 for letters, which have bit 6 set. A byte
+   is a digit when it lies in '0'-'9', or in 'a'-'f' once bit 5 is set to
+   fold 'A'-'F' into it; the ranges are checked with signed compares after
+   shifting them to the bottom of the signed byte range.
+
+   Input: *digits - 32 characters
+          *cells - where to store the 16 cell bytes, first digit in the high nibble
+
+   Output: 1 if all 32 characters were hex digits and 0 otherwise
+*/
+static inline int decodeHexBlock(const unsigned char *digits, unsigned char *cells) {
+    const __m128i low = _mm_set1_epi8(0x0f);
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i lowByte = _mm_set1_epi16(0x00ff);
+    __m128i halves[2];
+    int valid = 0xffff;
+    int i;
+    for(i = 0; i < 2; i++)
+    {
+        __m128i c = _mm_loadu_si128((const __m128i *)(digits + 16 * i));
+        __m128i number = _mm_cmplt_epi8(_mm_sub_epi8(c, _mm_set1_epi8('0' - 128)), _mm_set1_epi8(-128 + 10));
+        __m128i letter = _mm_cmplt_epi8(_mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a' - 128)),
+                                        _mm_set1_epi8(-128 + 6));
+        valid &= _mm_movemask_epi8(_mm_or_si128(number, letter));
+        __m128i v = _mm_add_epi8(_mm_and_si128(c, low),
+                                 _mm_and_si128(nine, _mm_cmpeq_epi8(_mm_and_si128(_mm_srli_epi16(c, 6), one), one)));
+        /* each 16-bit lane holds an even digit in its low byte and the next digit above it */
+        halves[i] = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, lowByte), 4), _mm_srli_epi16(v, 8));
+    }
+    _mm_storeu_si128((__m128i *)cells, _mm_packus_epi16(halves[0], halves[1]));
+    return valid == 0xffff;
+}
+#endif
+
+/* Function flushWriter
+
+   Writes the buffered bytes of a writer to its file
+
+   Input: *w - the writer to flush
+
+   Output: Void
+*/
+static void flushWriter(struct mazeWriter *w) {
+    if(w->length > 0 && fwrite(w->buffer, 1, w->length, w->fp) != w->length)
+        w->failed = 1;
+    w->length = 0;
+}
+
+/* Function openMazeWriter
+
+   Opens a buffered writer on a file. A fileName of "-" writes to stdout, so
+   a maze can be piped straight into another program.
+
+   Input: *w - the writer to open
+          *fileName - the file to write, or "-" for stdout
+
+   Output: 1 if the writer was opened and 0 otherwise
+*/
+int openMazeWriter(struct mazeWriter *w, const char *fileName) {
+    char *buffer = malloc(WRITER_BUFFER_SIZE);
+    if(buffer == NULL || openMazeWriterWithBuffer(w, fileName, buffer) == 0)
+    {
+        free(buffer);
+        return 0;
+    }
+    w->ownsBuffer = 1;
+    return 1;
+}
+
+/* Function openMazeWriterWithBuffer
+
+   Opens a buffered writer that collects output in a buffer owned by the
+   caller, so a worker writing many files allocates its buffer once.
+
+   Input: *w - the writer to open
+          *fileName - the file to write, or "-" for stdout
+          *buffer - WRITER_BUFFER_SIZE bytes, left allocated by closeMazeWriter
+
+   Output: 1 if the writer was opened and 0 otherwise
+*/
+int openMazeWriterWithBuffer(struct mazeWriter *w, const char *fileName, char *buffer) {
+    w->length = 0;
+    w->failed = 0;
+    w->ownsBuffer = 0;
+    w->buffer = buffer;
+    w->ownsFile = strcmp(fileName, "-") != 0;
+    w->fp = w->ownsFile ? fopen(fileName, "w+") : stdout;
+    return w->fp != NULL;
+}
+
+/* Function writeBytes
+
+   Copies bytes into the writer's buffer, writing out each block as it fills
+
+   Input: *w - the writer
+          *data - the bytes to write
+          n - the number of bytes
+
+   Output: Void
+*/
+void writeBytes(struct mazeWriter *w, const void *data, size_t n) {
+    const char *p = data;
+    while(n > 0)
+    {
+        size_t room = WRITER_BUFFER_SIZE - w->length;
+        size_t chunk = n < room ? n : room;
+        memcpy(w->buffer + w->length, p, chunk);
+        w->length += chunk;
+        p += chunk;
+        n -= chunk;
+        if(w->length == WRITER_BUFFER_SIZE)
+            flushWriter(w);
+    }
+}
+
+/* Function writeHexRow
+
+   Writes one row of packed rooms in hex form, one digit per room and a
+   newline. Each cell byte becomes two digits through a lookup table, written
+   straight into the buffer.
+
+   Input: *w - the writer
+          *cells - the packed row, two rooms per byte
+          columns - the number of rooms in the row
+
+   Output: Void
+*/
+void writeHexRow(struct mazeWriter *w, const unsigned char *cells, int columns) {
+    size_t pairs = (size_t)columns / 2;
+    while(pairs > 0)
+    {
+        if(WRITER_BUFFER_SIZE - w->length < 2)
+            flushWriter(w);
+        size_t room = (WRITER_BUFFER_SIZE - w->length) / 2;
+        size_t chunk = pairs < room ? pairs : room;
+        char *out = w->buffer + w->length;
+        size_t i;
+        for(i = 0; i < chunk; i++)
+            memcpy(out + 2 * i, hexPairs[cells[i]], 2);
+        w->length += 2 * chunk;
+        cells += chunk;
+        pairs -= chunk;
+    }
+    char tail[2];
+    size_t n = 0;
+    if(columns & 1)
+        tail[n++] = hexPairs[*cells][0];
+    tail[n++] = '\n';
+    writeBytes(w, tail, n);
+}
+
+/* Function closeMazeWriter
+
+   Writes out the rest of the buffer and closes the writer's file
+
+   Input: *w - the writer to close
+
+   Output: 1 if everything was written and 0 on a write error
+*/
+int closeMazeWriter(struct mazeWriter *w) {
+    flushWriter(w);
+    if(w->ownsFile)
+    {
+        if(fclose(w->fp) != 0)
+            w->failed = 1;
+    }
+    else if(fflush(w->fp) != 0)
+    {
+        w->failed = 1;
+    }
+    if(w->ownsBuffer)
+        free(w->buffer);
+    w->buffer = NULL;
+    return !w->failed;
+}
+
+/* Function parseMazeFormat
+
+   Looks up a maze file format by name
+
+   Input: *name - "hex", "binary" or "tree"
+
+   Output: The FORMAT_ constant, or -1 if the name is unknown
+*/
+int parseMazeFormat(const char *name) {
+    if(strcmp(name, "hex") == 0)
+        return FORMAT_HEX;
+    if(strcmp(name, "binary") == 0)
+        return FORMAT_BINARY;
+    if(strcmp(name, "tree") == 0)
+        return FORMAT_TREE;
+    return -1;
+}
+
+/* Function writeMazeHeader
+
+   Writes what comes before the rooms of a maze file. Hex files have no header.
+
+   Input: *w - the writer
+          format - the FORMAT_ of the file
+          rows, columns - the size of the maze
+          seed - the seed the maze was generated from
+
+   Output: Void
+*/
+void writeMazeHeader(struct mazeWriter *w, int format, int rows, int columns, uint64_t seed) {
+    if(format == FORMAT_HEX)
+        return;
+    struct mazeFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, format == FORMAT_TREE ? TREE_MAGIC : MAZE_MAGIC, sizeof(header.magic));
+    header.version = MAZE_FORMAT_VERSION;
+    header.rows = rows;
+    header.columns = columns;
+    header.seed = seed;
+    writeBytes(w, &header, sizeof(header));
+}
+
+/* Function writeMazeRow
+
+   Writes a row of packed rooms, as hex digits or as the packed bytes themselves
+
+   Input: *w - the writer
+          format - the FORMAT_ of the file
+          *cells - the packed row, two rooms per byte
+          columns - the number of rooms in the row
+
+   Output: Void
+*/
+void writeMazeRow(struct mazeWriter *w, int format, const unsigned char *cells, int columns) {
+    if(format == FORMAT_BINARY)
+        writeBytes(w, cells, ((size_t)columns + 1) / 2);
+    else
+        writeHexRow(w, cells, columns);
+}
+
+/* Function mazeFileFormat
+
+   Determines the format of a maze file from the magic it starts with
+
+   Input: *fileName - the file to check
+
+   Output: FORMAT_BINARY or FORMAT_TREE for those magics, FORMAT_HEX otherwise
+*/
+int mazeFileFormat(const char *fileName) {
+    char magic[4];
+    int format = FORMAT_HEX;
+    FILE *fp = fopen(fileName, "r");
+    if(fp == NULL)
+        return FORMAT_HEX;
+    if(fread(magic, 1, sizeof(magic), fp) == sizeof(magic))
+    {
+        if(memcmp(magic, MAZE_MAGIC, sizeof(magic)) == 0)
+            format = FORMAT_BINARY;
+        else if(memcmp(magic, TREE_MAGIC, sizeof(magic)) == 0)
+            format = FORMAT_TREE;
+    }
+    fclose(fp);
+    return format;
+}
+
+/* Function readHexMazeFile
+
+   Reads a hex maze file into a newly allocated maze. The file is mapped and
+   decoded straight into the packed cells, 32 digits per SSE2 block and 8 per
+   word on little-endian machines, and the rest through a lookup table, a
+   pair of digits per cell byte; bad digits are collected per row and checked
+   once the row is done. Every row must hold exactly columns digits and end
+   in a newline (or CR LF), except that the last may end the file.
+
+   Input: *m - the maze to set up
+          *fileName - the hex maze file
+          rows, columns - the size of the maze
+
+   Output: 1 if the maze was read and 0 if the file could not be read, is
+           malformed (reported on stderr) or memory ran out
+*/
+int readHexMazeFile(struct maze *m, const char *fileName, int rows, int columns) {
+    int fd = open(fileName, O_RDONLY);
+    if(fd < 0)
+        return 0;
+    struct stat st;
+    void *mapping = MAP_FAILED;
+    if(fstat(fd, &st) == 0 && st.st_size > 0)
+        mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+        return 0;
+    size_t length = st.st_size;
+    /* every cell byte is decoded, so the cells need no initial value */
+    unsigned char *decoded = malloc((size_t)rows * (((size_t)columns + 1) / 2));
+    if(decoded == NULL || createMazeOver(m, rows, columns, decoded, NULL, 0) == 0)
+    {
+        free(decoded);
+        munmap(mapping, length);
+        return 0;
+    }
+
+    const unsigned char *p = mapping;
+    const unsigned char *end = p + length;
+    int pairs = columns / 2;
+    int valid = 1;
+    int r, c;
+    for(r = 0; r < rows && valid; r++)
+    {
+        unsigned char *cells = m->cells + (size_t)r * m->stride;
+        unsigned char bad = 0;
+        c = 0;
+        if((size_t)(end - p) < (size_t)columns)
+        {
+            fprintf(stderr, "%s:%d: expected %d rows of %d columns\n", fileName, r + 1, rows, columns);
+            valid = 0;
+            break;
+        }
+#ifdef __SSE2__
+        for(; c + 16 <= pairs; c += 16)
+        {
+            if(decodeHexBlock(p, cells + c) == 0)
+                bad = HEX_DIGIT_INVALID;
+            p += 32;
+        }
+#endif
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        for(; c + 4 <= pairs; c += 4)
+        {
+            if(decodeHexWord(p, cells + c) == 0)
+                bad = HEX_DIGIT_INVALID;
+            p += 8;
+        }
+#endif
+        for(; c < pairs; c++)
+        {
+            unsigned char high = hexDigitValues[p[0]];
+            unsigned char low = hexDigitValues[p[1]];
+            bad |= high | low;
+            cells[c] = (unsigned char)(high << 4 | (low & ALLWALLS));
+            p += 2;
+        }
+        if(columns & 1)
+        {
+            unsigned char high = hexDigitValues[*p++];
+            bad |= high;
+            cells[c] = (unsigned char)(high << 4 | ALLWALLS);
+        }
+        if(p < end && *p == '\r')
+            p++;
+        if(bad & HEX_DIGIT_INVALID)
+        {
+            fprintf(stderr, "%s:%d: row has a character that is not a hex digit\n", fileName, r + 1);
+            valid = 0;
+        }
+        else if(p < end && *p++ != '\n')
+        {
+            fprintf(stderr, "%s:%d: row is longer than %d columns\n", fileName, r + 1, columns);
+            valid = 0;
+        }
+    }
+    while(valid && p < end && (*p == '\n' || *p == '\r' || *p == ' ' || *p == '\t'))
+        p++;
+    if(valid && p < end)
+    {
+        fprintf(stderr, "%s: more than %d rows\n", fileName, rows);
+        valid = 0;
+    }
+    munmap(mapping, length);
+    if(valid == 0)
+    {
+        destroyMaze(m);
+        return 0;
+    }
+    return 1;
+}
+
+/* Function mapMazeFile
+
+   Maps a binary maze file read-only and sets up a maze whose cells point into
+   the mapping, so nothing is parsed or copied. Pages are read as the maze
+   touches them.
+
+   Input: *m - the maze to set up
+          *fileName - the binary maze file
+          *seed - set to the seed recorded in the header, may be NULL
+
+   Output: 1 if the maze was mapped and 0 if the file is not a valid binary maze
+*/
+int mapMazeFile(struct maze *m, const char *fileName, uint64_t *seed) {
+    int fd = open(fileName, O_RDONLY);
+    if(fd < 0)
+        return 0;
+    struct stat st;
+    void *mapping = MAP_FAILED;
+    if(fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(struct mazeFileHeader))
+        mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+        return 0;
+
+    const struct mazeFileHeader *header = mapping;
+    size_t length = st.st_size;
+    if(memcmp(header->magic, MAZE_MAGIC, sizeof(header->magic)) != 0 || header->version != MAZE_FORMAT_VERSION ||
+       header->rows == 0 || header->columns == 0 || header->rows > INT32_MAX || header->columns > INT32_MAX ||
+       length - sizeof(*header) < (size_t)header->rows * ((header->columns + 1) / 2))
+    {
+        munmap(mapping, length);
+        return 0;
+    }
+    if(seed != NULL)
+        *seed = header->seed;
+    if(createMazeOver(m, header->rows, header->columns, (unsigned char *)mapping + sizeof(*header), mapping, length) == 0)
+    {
+        munmap(mapping, length);
+        return 0;
+    }
+    return 1;
+}
+
+/* Function encodeMazeTree
+
+   Encodes a perfect maze as the spanning tree rooted at room (0, 0), storing
+   the direction of each room's parent in 2 bits. The tree is walked without a
+   stack: the walk returns to a parent through the child's own parent
+   direction and resumes at the direction after the one it came back from.
+   The visited bitmap of the maze is used to detect cycles.
+
+   Input: *m - the maze to encode
+
+   Output: The parent directions, four rooms per byte (free with free), or NULL
+           if out of memory or the maze has a cycle or an unreachable room
+*/
+unsigned char *encodeMazeTree(struct maze *m) {
+    size_t rooms = (size_t)m->rows * m->columns;
+    unsigned char *tree = calloc((rooms + 3) / 4, 1);
+    if(tree == NULL)
+        return NULL;
+    clearVisited(m);
+
+    size_t reached = 1;
+    int row = 0, column = 0, next = 0;
+    markRoomVisited(m, 0, 0);
+    for(;;)
+    {
+        size_t room = (size_t)row * m->columns + column;
+        int parent = (tree[room / 4] >> (2 * (room % 4))) & 3;
+        if(next == 4)
+        {
+            if(row == 0 && column == 0)
+                break;
+            /* back to the parent, resuming after the direction that led here */
+            row += SouthNorthOffset[parent];
+            column += EastWestOffset[parent];
+            next = OPPOSITE_DIRECTION(parent) + 1;
+            continue;
+        }
+        int d = next++;
+        if(!roomHasOpenConnection(m, row, column, d) || (d == parent && (row != 0 || column != 0)))
+            continue;
+        int tempR = row + SouthNorthOffset[d];
+        int tempC = column + EastWestOffset[d];
+        if(roomOutOfBounds(tempR, tempC, m->columns, m->rows))
+            continue;
+        if(roomVisited(m, tempR, tempC))
+        {
+            free(tree);
+            return NULL;
+        }
+        markRoomVisited(m, tempR, tempC);
+        reached++;
+        row = tempR;
+        column = tempC;
+        room = (size_t)row * m->columns + column;
+        tree[room / 4] |= OPPOSITE_DIRECTION(d) << (2 * (room % 4));
+        next = 0;
+    }
+    if(reached != rooms)
+    {
+        free(tree);
+        return NULL;
+    }
+    return tree;
+}
+
+/* Function writeMaze
+
+   Writes a whole maze in a given format. A tree file is only written for a
+   perfect maze; otherwise the writer is marked as failed.
+
+   Input: *w - the writer
+          format - the FORMAT_ of the file
+          *m - the maze
+          seed - the seed recorded in binary and tree headers
+
+   Output: Void
+*/
+void writeMaze(struct mazeWriter *w, int format, struct maze *m, uint64_t seed) {
+    writeMazeHeader(w, format, m->rows, m->columns, seed);
+    if(format == FORMAT_TREE)
+    {
+        unsigned char *tree = encodeMazeTree(m);
+        if(tree == NULL)
+        {
+            w->failed = 1;
+            return;
+        }
+        writeBytes(w, tree, ((size_t)m->rows * m->columns + 3) / 4);
+        free(tree);
+        return;
+    }
+    int r;
+    for(r = 0; r < m->rows; r++)
+        writeMazeRow(w, format, &m->cells[(size_t)r * m->stride], m->columns);
+}
+
+/* Function readTreeMazeFile
+
+   Reads a tree maze file. Every room starts walled in and the connection to
+   its parent is opened on both sides, in one pass over the file.
+
+   Input: *m - the maze to create
+          *fileName - the tree maze file
+          *seed - set to the seed recorded in the header, may be NULL
+
+   Output: 1 if the maze was read and 0 if the file is not a valid tree maze
+*/
+int readTreeMazeFile(struct maze *m, const char *fileName, uint64_t *seed) {
+    int fd = open(fileName, O_RDONLY);
+    if(fd < 0)
+        return 0;
+    struct stat st;
+    void *mapping = MAP_FAILED;
+    if(fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(struct mazeFileHeader))
+        mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+        return 0;
+
+    const struct mazeFileHeader *header = mapping;
+    size_t length = st.st_size;
+    size_t rooms = (size_t)header->rows * header->columns;
+    if(memcmp(header->magic, TREE_MAGIC, sizeof(header->magic)) != 0 || header->version != MAZE_FORMAT_VERSION ||
+       header->rows == 0 || header->columns == 0 || header->rows > INT32_MAX || header->columns > INT32_MAX ||
+       length - sizeof(*header) < (rooms + 3) / 4 || createMaze(m, header->rows, header->columns, ALLWALLS) == 0)
+    {
+        munmap(mapping, length);
+        return 0;
+    }
+    if(seed != NULL)
+        *seed = header->seed;
+    madvise(mapping, length, MADV_SEQUENTIAL);
+
+    const unsigned char *tree = (const unsigned char *)mapping + sizeof(*header);
+    int ok = 1;
+    int r, c;
+    size_t room = 0;
+    for(r = 0; r < m->rows && ok; r++)
+    {
+        for(c = 0; c < m->columns; c++, room++)
+        {
+            if(room == 0)
+                continue;
+            int parent = (tree[room / 4] >> (2 * (room % 4))) & 3;
+            if(roomOutOfBounds(r + SouthNorthOffset[parent], c + EastWestOffset[parent], m->columns, m->rows))
+            {
+                ok = 0;
+                break;
+            }
+            openRoomConnection(m, r, c, parent);
+        }
+    }
+    munmap(mapping, length);
+    if(!ok)
+        destroyMaze(m);
+    return ok;
+}
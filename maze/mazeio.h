@@ -0,0 +1,89 @@
+#ifndef MAZEIO_H
+#define MAZEIO_H
+
+#include <stdio.h>
+#include "common.h"
+
+/* Maze file formats */
+#define FORMAT_HEX 0        /* one hex digit per room, one line per row */
+#define FORMAT_BINARY 1     /* mazeFileHeader followed by the packed cells */
+#define FORMAT_TREE 2       /* mazeFileHeader followed by 2 bits per room */
+
+/* Identifies binary and tree maze files */
+#define MAZE_MAGIC "MAZE"
+#define TREE_MAGIC "MAZT"
+#define MAZE_FORMAT_VERSION 1
+
+/* Header of a binary maze file. It is followed by rows * ((columns + 1) / 2)
+   bytes of rooms packed exactly like the cells of a struct maze, so a mapped
+   file is used in place. Fields are in host byte order.
+
+   A tree maze file has the same header with TREE_MAGIC and encodes a perfect
+   maze as the spanning tree rooted at room (0, 0): every other room stores the
+   direction of its parent in 2 bits, four rooms per byte in row-major order,
+   the first room in the low bits. Each connection is stored once, by the child. */
+struct mazeFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t rows;
+    uint32_t columns;
+    uint64_t seed;
+};
+
+/* Size of the block a mazeWriter collects before writing */
+#define WRITER_BUFFER_SIZE (1 << 20)
+
+/* A buffered output stream for maze files. Output is collected in one
+   reusable buffer and written in WRITER_BUFFER_SIZE blocks. */
+struct mazeWriter {
+    FILE *fp;
+    int ownsFile;           /* 0 when writing to stdout */
+    int ownsBuffer;         /* 0 when the caller supplied the buffer */
+    char *buffer;
+    size_t length;
+    int failed;
+};
+
+/* Opens a writer on a file, or on stdout when fileName is "-" */
+int openMazeWriter(struct mazeWriter *w, const char *fileName);
+
+/* Opens a writer that collects output in a caller's WRITER_BUFFER_SIZE buffer */
+int openMazeWriterWithBuffer(struct mazeWriter *w, const char *fileName, char *buffer);
+
+/* Writes bytes through a writer */
+void writeBytes(struct mazeWriter *w, const void *data, size_t n);
+
+/* Writes a row of packed rooms as hex digits followed by a newline */
+void writeHexRow(struct mazeWriter *w, const unsigned char *cells, int columns);
+
+/* Writes out anything buffered and closes the writer */
+int closeMazeWriter(struct mazeWriter *w);
+
+/* Looks up a maze file format by name */
+int parseMazeFormat(const char *name);
+
+/* Writes what comes before the rows of a maze file in a given format */
+void writeMazeHeader(struct mazeWriter *w, int format, int rows, int columns, uint64_t seed);
+
+/* Writes a row of packed rooms in a given format */
+void writeMazeRow(struct mazeWriter *w, int format, const unsigned char *cells, int columns);
+
+/* Determines the format of a maze file from its magic */
+int mazeFileFormat(const char *fileName);
+
+/* Encodes a perfect maze as the parent direction of every room */
+unsigned char *encodeMazeTree(struct maze *m);
+
+/* Writes a whole maze in a given format */
+void writeMaze(struct mazeWriter *w, int format, struct maze *m, uint64_t seed);
+
+/* Reads a hex maze file of a known size, checking every row */
+int readHexMazeFile(struct maze *m, const char *fileName, int rows, int columns);
+
+/* Reads a tree maze file, rebuilding its walls */
+int readTreeMazeFile(struct maze *m, const char *fileName, uint64_t *seed);
+
+/* Maps a binary maze file and sets up a maze over it without copying */
+int mapMazeFile(struct maze *m, const char *fileName, uint64_t *seed);
+
+#endif
@@ -0,0 +1,1278 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "mazesolve.h"
+#include "parallel.h"
+
+/* Parent entries of rooms: 0 for a room not reached yet, otherwise
+   PARENT_REACHED with the direction back toward the start in the low 2 bits.
+   The start room is marked PARENT_START instead. Depth first search keeps
+   the index of the next direction to try in bits 4-6, so it backtracks
+   through the parents without a stack. */
+#define PARENT_REACHED 4
+#define PARENT_START 8
+#define PARENT_DIRECTION(p) ((p) & 3)
+#define PARENT_NEXT(p) (((p) >> 4) & 7)
+#define PARENT_WITH_NEXT(p, next) (((p) & 0x0f) | ((next) << 4))
+
+/* A* keeps whether a room's f cost is on an even or odd step of 2 in bit 4
+   and marks rooms it has expanded with bit 5; bidirectional search marks the
+   rooms reached from the end with bit 4 */
+#define PARENT_LEVEL 0x10
+#define PARENT_CLOSED 0x20
+#define PARENT_END_SIDE 0x10
+
+/* A room's mark holds its parent entry in the low 8 bits and the generation
+   of the search that wrote it above them; marks of older searches read as 0 */
+#define MAX_GENERATION 0xffffffu
+#define MARK(generation, parent) ((generation) << 8 | (parent))
+
+const struct solveEngine solveEngines[] = {
+    {"dfs-full", "depth first search, every room entered", 1, 0, 0, dfsFullSolve},
+    {"dfs-pruned", "depth first search, the path it found", 0, 0, 0, dfsPrunedSolve},
+    {"bfs", "breadth first search, a shortest path", 0, 0, 0, bfsSolve},
+    {"astar", "A* with a Manhattan heuristic, a shortest path", 0, 0, 0, astarSolve},
+    {"bidirectional", "breadth first from both ends, a shortest path", 0, 0, 0, bidirectionalSolve},
+    {"junction", "Dijkstra over junctions with corridors contracted, a shortest path", 0, 0, 1, junctionSolve},
+    {"deadend", "dead-end filling on every core, then the path left", 0, 0, 0, deadEndSolve},
+    {"lca", "perfect mazes only, tree index path", 0, 1, 0, lcaSolve},
+    {NULL, NULL, 0, 0, 0, NULL}
+};
+
+/* Function findSolveEngine
+
+   Looks up a solver engine by name
+
+   Input: *name - the name of the engine
+
+   Output: The engine, or NULL if there is none by that name
+*/
+const struct solveEngine *findSolveEngine(const char *name) {
+    const struct solveEngine *e;
+    for(e = solveEngines; e->name != NULL; e++)
+    {
+        if(strcmp(e->name, name) == 0)
+            return e;
+    }
+    return NULL;
+}
+
+/* Function reserveSolveScratch
+
+   Grows search scratch memory to hold a maze of a number of rooms. Memory is
+   only reallocated when it is too small, so one scratch serves many queries.
+   Grown marks are cleared and the generation count starts over.
+
+   Input: *scratch - the scratch memory, zeroed before its first use
+          rooms - the number of rooms in the maze
+
+   Output: 1 if the scratch memory holds the rooms and 0 if out of memory
+*/
+int reserveSolveScratch(struct solveScratch *scratch, size_t rooms) {
+    if(rooms <= scratch->capacity)
+        return 1;
+    uint32_t *queue = realloc(scratch->queue, rooms * sizeof(uint32_t));
+    if(queue == NULL)
+        return 0;
+    scratch->queue = queue;
+    uint32_t *marks = realloc(scratch->marks, rooms * sizeof(uint32_t));
+    if(marks == NULL)
+        return 0;
+    memset(marks, 0, rooms * sizeof(uint32_t));
+    scratch->marks = marks;
+    scratch->generation = 0;
+    scratch->capacity = rooms;
+    return 1;
+}
+
+/* Function beginSearch
+
+   Starts a search of a maze. Rooms reached by earlier searches are forgotten
+   by moving to a new generation of marks, so nothing is cleared; only when
+   the generations run out are the marks zeroed, once every 2^24 searches.
+
+   Input: *scratch - search scratch memory
+          rooms - the number of rooms, or junctions, searched
+
+   Output: 1 if the scratch memory is ready and 0 if out of memory or the maze is too large
+*/
+static int beginSearch(struct solveScratch *scratch, size_t rooms) {
+    if(rooms > MAX_SOLVE_ROOMS || reserveSolveScratch(scratch, rooms) == 0)
+        return 0;
+    if(++scratch->generation > MAX_GENERATION)
+    {
+        memset(scratch->marks, 0, scratch->capacity * sizeof(uint32_t));
+        scratch->generation = 1;
+    }
+    return 1;
+}
+
+/* Parent entry of a room in the current search, 0 if it has not been reached */
+static inline unsigned int roomParent(const struct solveScratch *scratch, uint32_t room) {
+    uint32_t mark = scratch->marks[room];
+    return (mark >> 8) == scratch->generation ? (mark & 0xff) : 0;
+}
+
+/* Stores the parent entry of a room in the current search */
+static inline void storeRoomParent(struct solveScratch *scratch, uint32_t room, unsigned int parent) {
+    scratch->marks[room] = MARK(scratch->generation, parent);
+}
+
+/* Function freeSolveScratch
+
+   Releases search scratch memory
+
+   Input: *scratch - the scratch memory
+
+   Output: Void
+*/
+void freeSolveScratch(struct solveScratch *scratch) {
+    free(scratch->queue);
+    free(scratch->marks);
+    free(scratch->steps);
+    free(scratch->heap);
+    free((void *)scratch->sides);
+    scratch->queue = NULL;
+    scratch->marks = NULL;
+    scratch->steps = NULL;
+    scratch->heap = NULL;
+    scratch->sides = NULL;
+    scratch->generation = 0;
+    scratch->capacity = 0;
+    scratch->stepsCapacity = 0;
+    scratch->heapCapacity = 0;
+    scratch->sidesCapacity = 0;
+}
+
+/* Function freeSolvePath
+
+   Releases the rooms of a path
+
+   Input: *path - the path
+
+   Output: Void
+*/
+void freeSolvePath(struct solvePath *path) {
+    free(path->rooms);
+    path->rooms = NULL;
+    path->length = 0;
+    path->capacity = 0;
+}
+
+/* Function reservePath
+
+   Grows the memory of a path to hold a number of rooms
+
+   Input: *path - the path
+          length - the number of rooms it must hold
+
+   Output: 1 if the path holds the rooms and 0 if out of memory
+*/
+static int reservePath(struct solvePath *path, size_t length) {
+    if(length > path->capacity)
+    {
+        uint32_t *rooms = realloc(path->rooms, length * sizeof(uint32_t));
+        if(rooms == NULL)
+            return 0;
+        path->rooms = rooms;
+        path->capacity = length;
+    }
+    return 1;
+}
+
+/* Function tracePath
+
+   Rebuilds the path to a room by following parent directions back to the start
+
+   Input: *m - the maze searched
+          *scratch - search scratch memory holding the parent of every reached room
+          end - the room number the path ends at
+          *path - where to store the path
+
+   Output: 1 if the path was stored and 0 if out of memory
+*/
+static int tracePath(const struct maze *m, const struct solveScratch *scratch, uint32_t end, struct solvePath *path) {
+    const long step[4] = {1, -1, m->columns, -(long)m->columns};
+    size_t length = 1;
+    uint32_t room;
+    for(room = end; !(roomParent(scratch, room) & PARENT_START); room += step[PARENT_DIRECTION(roomParent(scratch, room))])
+        length++;
+    if(reservePath(path, length) == 0)
+        return 0;
+    path->length = length;
+    room = end;
+    while(length > 0)
+    {
+        path->rooms[--length] = room;
+        if(!(roomParent(scratch, room) & PARENT_START))
+            room += step[PARENT_DIRECTION(roomParent(scratch, room))];
+    }
+    return 1;
+}
+
+/* Function appendPathRoom
+
+   Adds a room to the end of a path, at least doubling its memory when full
+
+   Input: *path - the path
+          room - the room number to add
+
+   Output: 1 if the room was added and 0 if out of memory
+*/
+static int appendPathRoom(struct solvePath *path, uint32_t room) {
+    if(path->length == path->capacity)
+    {
+        size_t capacity = path->capacity ? 2 * path->capacity : 1024;
+        uint32_t *rooms = realloc(path->rooms, capacity * sizeof(uint32_t));
+        if(rooms == NULL)
+            return 0;
+        path->rooms = rooms;
+        path->capacity = capacity;
+    }
+    path->rooms[path->length++] = room;
+    return 1;
+}
+
+/* Function bfsSolve
+
+   Finds a shortest path between two rooms by breadth first search. Rooms are
+   numbered row-major; the queue and marks are flat arrays of the scratch
+   memory, so the search makes no allocation per room and never recurses. Each
+   room enters the queue at most once, so it needs no more than one entry per room.
+
+   Input: *m - the maze to search
+          startRow, startColumn - the room to start from
+          endRow, endColumn - the room to find a path to
+          *scratch - search scratch memory
+          *path - where to store the path, from start to end
+
+   Output: 1 if a path was found, 0 if the end cannot be reached and -1 if out of memory
+*/
+int bfsSolve(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+             struct solveScratch *scratch, struct solvePath *path) {
+    if(beginSearch(scratch, (size_t)m->rows * m->columns) == 0)
+        return -1;
+    uint32_t *queue = scratch->queue;
+    const long step[4] = {1, -1, m->columns, -(long)m->columns};
+    uint32_t start = (uint32_t)startRow * m->columns + startColumn;
+    uint32_t end = (uint32_t)endRow * m->columns + endColumn;
+    size_t head = 0, tail = 0;
+
+    storeRoomParent(scratch, start, PARENT_START);
+    path->length = 0;
+    queue[tail++] = start;
+    while(head < tail)
+    {
+        uint32_t room = queue[head++];
+        scratch->expanded++;
+        if(room == end)
+            return tracePath(m, scratch, end, path) ? 1 : -1;
+        int row = room / m->columns;
+        int column = room - (uint32_t)row * m->columns;
+        unsigned int hexValue = roomHexValue(m, row, column);
+        int d;
+        for(d = 0; d < 4; d++)
+        {
+            if((hexValue & DIRECTION_HEX(d)) ||
+               roomOutOfBounds(row + SouthNorthOffset[d], column + EastWestOffset[d], m->columns, m->rows))
+                continue;
+            uint32_t next = room + step[d];
+            if(roomParent(scratch, next) == 0)
+            {
+                storeRoomParent(scratch, next, PARENT_REACHED | OPPOSITE_DIRECTION(d));
+                queue[tail++] = next;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Function distanceField
+
+   Finds the steps from one room to every room of a maze by a breadth first
+   search that stores each room's distance as it is reached, so the distances
+   are also the marks of the rooms seen. Costs one pass over the rooms and a
+   queue of 4 bytes per room besides the distances.
+
+   Input: *m - the maze to search
+          startRow, startColumn - the room to measure from
+          *distances - set to the steps to each room in row-major order,
+          UNREACHED where there is no path
+          *farthest - set to the room number of a room farthest from the start
+
+   Output: The number of rooms reached, 0 if out of memory or the maze is too large
+*/
+size_t distanceField(const struct maze *m, int startRow, int startColumn, uint32_t *distances, uint32_t *farthest) {
+    size_t rooms = (size_t)m->rows * m->columns;
+    if(rooms > MAX_SOLVE_ROOMS)
+        return 0;
+    uint32_t *queue = malloc(rooms * sizeof(uint32_t));
+    if(queue == NULL)
+        return 0;
+    const long step[4] = {1, -1, m->columns, -(long)m->columns};
+    uint32_t start = (uint32_t)startRow * m->columns + startColumn;
+    size_t head = 0, tail = 0;
+
+    memset(distances, 0xff, rooms * sizeof(uint32_t));
+    distances[start] = 0;
+    queue[tail++] = start;
+    while(head < tail)
+    {
+        uint32_t room = queue[head++];
+        uint32_t distance = distances[room] + 1;
+        int row = room / m->columns;
+        int column = room - (uint32_t)row * m->columns;
+        unsigned int hexValue = roomHexValue(m, row, column);
+        int d;
+        for(d = 0; d < 4; d++)
+        {
+            if((hexValue & DIRECTION_HEX(d)) ||
+               roomOutOfBounds(row + SouthNorthOffset[d], column + EastWestOffset[d], m->columns, m->rows))
+                continue;
+            uint32_t next = room + step[d];
+            if(distances[next] == UNREACHED)
+            {
+                distances[next] = distance;
+                queue[tail++] = next;
+            }
+        }
+    }
+    *farthest = queue[tail - 1];
+    free(queue);
+    return tail;
+}
+
+/* Function dfsSearch
+
+   Performs a depth first search trying directions in the order east, west,
+   south, north. Each room's parent entry holds the next direction to try and
+   the way back, so the search walks forward and back through the maze with
+   neither recursion nor a stack.
+
+   Input: *m - the maze to search
+          startRow, startColumn - the room to start from
+          endRow, endColumn - the room to find a path to
+          *scratch - search scratch memory
+          *path - where to store the result
+          full - 1 to store every room entered in order, 0 for the path found
+
+   Output: 1 if a path was found, 0 if the end cannot be reached and -1 if out of memory
+*/
+static int dfsSearch(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+                     struct solveScratch *scratch, struct solvePath *path, int full) {
+    if(beginSearch(scratch, (size_t)m->rows * m->columns) == 0)
+        return -1;
+    const long step[4] = {1, -1, m->columns, -(long)m->columns};
+    uint32_t room = (uint32_t)startRow * m->columns + startColumn;
+    uint32_t end = (uint32_t)endRow * m->columns + endColumn;
+    int row = startRow, column = startColumn;
+
+    storeRoomParent(scratch, room, PARENT_START);
+    scratch->expanded++;
+    path->length = 0;
+    if(full && appendPathRoom(path, room) == 0)
+        return -1;
+    while(room != end)
+    {
+        unsigned int parent = roomParent(scratch, room);
+        unsigned int hexValue = roomHexValue(m, row, column);
+        int d;
+        for(d = PARENT_NEXT(parent); d < 4; d++)
+        {
+            if(!(hexValue & DIRECTION_HEX(d)) &&
+               !roomOutOfBounds(row + SouthNorthOffset[d], column + EastWestOffset[d], m->columns, m->rows) &&
+               roomParent(scratch, room + step[d]) == 0)
+                break;
+        }
+        if(d < 4)
+        {
+            storeRoomParent(scratch, room, PARENT_WITH_NEXT(parent, d + 1));
+            room += step[d];
+            row += SouthNorthOffset[d];
+            column += EastWestOffset[d];
+            storeRoomParent(scratch, room, PARENT_REACHED | OPPOSITE_DIRECTION(d));
+            scratch->expanded++;
+            if(full && appendPathRoom(path, room) == 0)
+                return -1;
+        }
+        else if(parent & PARENT_START)
+        {
+            return 0;
+        }
+        else
+        {
+            d = PARENT_DIRECTION(parent);
+            room += step[d];
+            row += SouthNorthOffset[d];
+            column += EastWestOffset[d];
+        }
+    }
+    if(full)
+        return 1;
+    return tracePath(m, scratch, end, path) ? 1 : -1;
+}
+
+/* Function dfsFullSolve
+
+   Performs a depth first search and stores FULL output: every room entered
+   by the search in order, ending at the end room when it is reached
+
+   Input: *m - the maze to search
+          startRow, startColumn - the room to start from
+          endRow, endColumn - the room to find a path to
+          *scratch - search scratch memory
+          *path - where to store the rooms entered
+
+   Output: 1 if a path was found, 0 if the end cannot be reached and -1 if out of memory
+*/
+int dfsFullSolve(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+                 struct solveScratch *scratch, struct solvePath *path) {
+    return dfsSearch(m, startRow, startColumn, endRow, endColumn, scratch, path, 1);
+}
+
+/* Function dfsPrunedSolve
+
+   Performs a depth first search and stores PRUNED output: the path it found,
+   without the dead ends it backed out of
+
+   Input: *m - the maze to search
+          startRow, startColumn - the room to start from
+          endRow, endColumn - the room to find a path to
+          *scratch - search scratch memory
+          *path - where to store the path, from start to end
+
+   Output: 1 if a path was found, 0 if the end cannot be reached and -1 if out of memory
+*/
+int dfsPrunedSolve(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+                   struct solveScratch *scratch, struct solvePath *path) {
+    return dfsSearch(m, startRow, startColumn, endRow, endColumn, scratch, path, 0);
+}
+
+/* Function lcaSolve
+
+   Finds the path between two rooms of a perfect maze from the mazeIndex of the
+   scratch memory without searching. The path climbs from the start to the
+   lowest common ancestor of the two rooms and down to the end; its length is
+   known from their depths, so it is filled from both ends at once. The maze
+   is not read, only its size.
+
+   Input: *m - the maze the index belongs to
+          startRow, startColumn - the room to start from
+          endRow, endColumn - the room to find a path to
+          *scratch - search scratch memory holding the index
+          *path - where to store the path, from start to end
+
+   Output: 1 if a path was found and -1 if out of memory or there is no index
+*/
+int lcaSolve(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+             struct solveScratch *scratch, struct solvePath *path) {
+    const struct mazeIndex *x = scratch->index;
+    if(x == NULL || x->rows != m->rows || x->columns != m->columns)
+        return -1;
+    const long step[4] = {1, -1, m->columns, -(long)m->columns};
+    uint32_t start = (uint32_t)startRow * m->columns + startColumn;
+    uint32_t end = (uint32_t)endRow * m->columns + endColumn;
+    uint32_t ancestor = indexAncestor(x, start, end);
+    size_t up = x->depths[start] - x->depths[ancestor];
+    size_t length = up + x->depths[end] - x->depths[ancestor] + 1;
+    if(reservePath(path, length) == 0)
+        return -1;
+    path->length = length;
+    size_t i;
+    for(i = 0; i < up; i++, start += step[x->parents[start]])
+        path->rooms[i] = start;
+    for(i = length - 1; i > up; i--, end += step[x->parents[end]])
+        path->rooms[i] = end;
+    path->rooms[up] = ancestor;
+    return 1;
+}
+
+/* Manhattan distance between two rooms, the A* heuristic */
+static inline uint32_t manhattan(int row, int column, int endRow, int endColumn) {
+    return (uint32_t)(abs(row - endRow) + abs(column - endColumn));
+}
+
+/* Function astarSolve
+
+   Finds a shortest path between two rooms by A* search with the Manhattan
+   distance to the end as its heuristic. On a grid every step changes f =
+   g + h by 0 or 2 and the heuristic is consistent, so the open rooms always
+   have f equal to the lowest open f or 2 more. A bucketed queue of just two
+   buckets therefore replaces a heap: a stack of rooms at the current f,
+   growing up from the start of the scratch queue, and a stack at f + 2,
+   growing down from its end. Which of the two a room is in is kept in its
+   parent entry, so a room found again by a shorter path moves from the upper
+   bucket to the current one; its stale entry is skipped once the room is
+   expanded. Popping the current bucket last in first out follows one
+   promising corridor deeply before its siblings.
+
+   Input: *m - the maze to search
+          startRow, startColumn - the room to start from
+          endRow, endColumn - the room to find a path to
+          *scratch - search scratch memory
+          *path - where to store the path, from start to end
+
+   Output: 1 if a path was found, 0 if the end cannot be reached and -1 if out of memory
+*/
+int astarSolve(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+               struct solveScratch *scratch, struct solvePath *path) {
+    if(beginSearch(scratch, (size_t)m->rows * m->columns) == 0)
+        return -1;
+    uint32_t *queue = scratch->queue;
+    size_t rooms = (size_t)m->rows * m->columns;
+    const long step[4] = {1, -1, m->columns, -(long)m->columns};
+    uint32_t start = (uint32_t)startRow * m->columns + startColumn;
+    uint32_t end = (uint32_t)endRow * m->columns + endColumn;
+    uint32_t f = manhattan(startRow, startColumn, endRow, endColumn);
+    size_t current = 0, later = 0;
+
+#define LEVEL_BIT(f) ((((f) >> 1) & 1) ? PARENT_LEVEL : 0)
+    storeRoomParent(scratch, start, PARENT_START | LEVEL_BIT(f));
+    path->length = 0;
+    queue[current++] = start;
+    for(;;)
+    {
+        if(current == 0)
+        {
+            /* move up a level, keeping only the rooms still open */
+            size_t i;
+            for(i = 0; i < later; i++)
+            {
+                uint32_t room = queue[rooms - 1 - i];
+                if(!(roomParent(scratch, room) & PARENT_CLOSED))
+                    queue[current++] = room;
+            }
+            later = 0;
+            f += 2;
+            if(current == 0)
+                return 0;
+        }
+        uint32_t room = queue[--current];
+        unsigned int parent = roomParent(scratch, room);
+        if(parent & PARENT_CLOSED)
+            continue;
+        storeRoomParent(scratch, room, parent | PARENT_CLOSED);
+        scratch->expanded++;
+        if(room == end)
+            return tracePath(m, scratch, end, path) ? 1 : -1;
+        int row = room / m->columns;
+        int column = room - (uint32_t)row * m->columns;
+        uint32_t g = f - manhattan(row, column, endRow, endColumn);
+        unsigned int hexValue = roomHexValue(m, row, column);
+        int d;
+        for(d = 0; d < 4; d++)
+        {
+            int nextRow = row + SouthNorthOffset[d], nextColumn = column + EastWestOffset[d];
+            if((hexValue & DIRECTION_HEX(d)) || roomOutOfBounds(nextRow, nextColumn, m->columns, m->rows))
+                continue;
+            uint32_t next = room + step[d];
+            uint32_t nextF = g + 1 + manhattan(nextRow, nextColumn, endRow, endColumn);
+            unsigned int nextParent = roomParent(scratch, next);
+            if(nextParent != 0 && ((nextParent & PARENT_CLOSED) || nextF != f ||
+                                   (nextParent & PARENT_LEVEL) == LEVEL_BIT(f)))
+                continue;
+            storeRoomParent(scratch, next, PARENT_REACHED | OPPOSITE_DIRECTION(d) | LEVEL_BIT(nextF));
+            if(current + later == rooms)
+            {
+                /* only rooms found again leave stale entries; drop them to make space */
+                size_t i, kept = 0;
+                for(i = 0; i < later; i++)
+                {
+                    uint32_t open = queue[rooms - 1 - i];
+                    unsigned int openParent = roomParent(scratch, open);
+                    if(!(openParent & PARENT_CLOSED) && (openParent & PARENT_LEVEL) != LEVEL_BIT(f))
+                        queue[rooms - 1 - kept++] = open;
+                }
+                later = kept;
+            }
+            if(nextF == f)
+                queue[current++] = next;
+            else
+                queue[rooms - 1 - later++] = next;
+        }
+    }
+#undef LEVEL_BIT
+}
+
+/* Function bidirectionalSolve
+
+   Finds a shortest path between two rooms by breadth first searches from
+   both ends that stop when they meet. Each step expands a whole level of
+   whichever search has the smaller frontier, so on open or braided mazes the
+   two searches touch far fewer rooms than one search from the start. The
+   search from the start keeps its FIFO at the beginning of the scratch queue
+   and the search from the end at its end, growing down; every room enters
+   one of them at most once. The first room found from one side that the
+   other side has reached joins the two halves; every meeting in a level
+   gives a path of the same length, so it is a shortest one. The end's
+   search walks passages backwards, so it steps into a neighbour only when
+   the neighbour's wall facing the room is open, which keeps it right on
+   mazes whose walls disagree.
+
+   Input: *m - the maze to search
+          startRow, startColumn - the room to start from
+          endRow, endColumn - the room to find a path to
+          *scratch - search scratch memory
+          *path - where to store the path, from start to end
+
+   Output: 1 if a path was found, 0 if the end cannot be reached and -1 if out of memory
+*/
+int bidirectionalSolve(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+                       struct solveScratch *scratch, struct solvePath *path) {
+    if(beginSearch(scratch, (size_t)m->rows * m->columns) == 0)
+        return -1;
+    uint32_t *queue = scratch->queue;
+    size_t rooms = (size_t)m->rows * m->columns;
+    const long step[4] = {1, -1, m->columns, -(long)m->columns};
+    uint32_t start = (uint32_t)startRow * m->columns + startColumn;
+    uint32_t end = (uint32_t)endRow * m->columns + endColumn;
+    /* FIFO entries of each side: [head, tail) from the start, mirrored from the end */
+    size_t head[2] = {0, 0}, tail[2] = {0, 0};
+    uint32_t meetFromStart = start, meetFromEnd = end;
+    int met = (start == end);
+
+    storeRoomParent(scratch, start, PARENT_START);
+    path->length = 0;
+    queue[tail[0]++] = start;
+    if(!met)
+    {
+        storeRoomParent(scratch, end, PARENT_START | PARENT_END_SIDE);
+        queue[rooms - 1 - tail[1]++] = end;
+    }
+    while(!met && head[0] < tail[0] && head[1] < tail[1])
+    {
+        int side = (tail[0] - head[0] <= tail[1] - head[1]) ? 0 : 1;
+        unsigned int sideBit = side ? PARENT_END_SIDE : 0;
+        size_t levelEnd = tail[side];
+        while(!met && head[side] < levelEnd)
+        {
+            size_t slot = head[side]++;
+            uint32_t room = side ? queue[rooms - 1 - slot] : queue[slot];
+            scratch->expanded++;
+            int row = room / m->columns;
+            int column = room - (uint32_t)row * m->columns;
+            unsigned int hexValue = roomHexValue(m, row, column);
+            int d;
+            for(d = 0; d < 4; d++)
+            {
+                int nextRow = row + SouthNorthOffset[d], nextColumn = column + EastWestOffset[d];
+                if(roomOutOfBounds(nextRow, nextColumn, m->columns, m->rows) ||
+                   (side ? roomHasWall(m, nextRow, nextColumn, OPPOSITE_DIRECTION(d)) : (hexValue & DIRECTION_HEX(d)) != 0))
+                    continue;
+                uint32_t next = room + step[d];
+                unsigned int nextParent = roomParent(scratch, next);
+                if(nextParent == 0)
+                {
+                    storeRoomParent(scratch, next, PARENT_REACHED | OPPOSITE_DIRECTION(d) | sideBit);
+                    if(side)
+                        queue[rooms - 1 - tail[1]++] = next;
+                    else
+                        queue[tail[0]++] = next;
+                }
+                else if((nextParent & PARENT_END_SIDE) != sideBit)
+                {
+                    meetFromStart = side ? next : room;
+                    meetFromEnd = side ? room : next;
+                    met = 1;
+                    break;
+                }
+            }
+        }
+    }
+    if(!met)
+        return 0;
+
+    /* the start's half is traced back from where it met, the end's half forward */
+    size_t fromStart = 1, fromEnd = 1;
+    uint32_t room;
+    for(room = meetFromStart; !(roomParent(scratch, room) & PARENT_START); room += step[PARENT_DIRECTION(roomParent(scratch, room))])
+        fromStart++;
+    if(meetFromEnd != meetFromStart)
+    {
+        for(room = meetFromEnd; !(roomParent(scratch, room) & PARENT_START); room += step[PARENT_DIRECTION(roomParent(scratch, room))])
+            fromEnd++;
+    }
+    else
+    {
+        fromEnd = 0;
+    }
+    if(reservePath(path, fromStart + fromEnd) == 0)
+        return -1;
+    path->length = fromStart + fromEnd;
+    size_t i = fromStart;
+    for(room = meetFromStart; i > 0; room += step[PARENT_DIRECTION(roomParent(scratch, room))])
+    {
+        path->rooms[--i] = room;
+        if(roomParent(scratch, room) & PARENT_START)
+            break;
+    }
+    i = fromStart;
+    for(room = meetFromEnd; i < path->length; room += step[PARENT_DIRECTION(roomParent(scratch, room))])
+    {
+        path->rooms[i++] = room;
+        if(roomParent(scratch, room) & PARENT_START)
+            break;
+    }
+    return 1;
+}
+
+/* How a start or end room joins a junction graph: the junction reached by
+   following its corridor in a direction, and the steps taken to reach it */
+struct junctionLink {
+    uint32_t junction;
+    uint32_t length;
+    int direction;          /* -1 when the room is the junction itself */
+};
+
+/* Function linkToJunctions
+
+   Finds how a room joins a junction graph. A junction joins as itself and a
+   corridor room through the junctions at both ends of its corridor. Walking
+   a corridor from the start can instead reach the end room, which gives a
+   direct path along the corridor; a corridor that loops back to the room
+   without a junction joins nothing.
+
+   Input: *g - the junction graph
+          *m - the maze
+          room - the room number to join
+          other - the end room when joining the start, to notice a direct path, and NO_JUNCTION otherwise
+          links - set to the links, at most two
+          *direct - the steps of the shortest direct path found, lowered if a shorter one is found
+          *directDirection - set to the direction of the first step of a shorter direct path
+
+   Output: The number of links
+*/
+static int linkToJunctions(const struct junctionGraph *g, const struct maze *m, uint32_t room, uint32_t other,
+                           struct junctionLink *links, uint64_t *direct, int *directDirection) {
+    uint32_t junction = findJunction(g, room);
+    if(junction != NO_JUNCTION)
+    {
+        links[0].junction = junction;
+        links[0].length = 0;
+        links[0].direction = -1;
+        return 1;
+    }
+    int row = room / m->columns;
+    int column = room - (uint32_t)row * m->columns;
+    unsigned int hexValue = roomHexValue(m, row, column);
+    int count = 0, d;
+    for(d = 0; d < 4; d++)
+    {
+        if(hexValue & DIRECTION_HEX(d))
+            continue;
+        uint32_t length;
+        uint32_t reached = followCorridor(g, m, room, d, other, &length);
+        if(reached == other)
+        {
+            if(length < *direct)
+            {
+                *direct = length;
+                *directDirection = d;
+            }
+        }
+        else if(reached != room)
+        {
+            links[count].junction = findJunction(g, reached);
+            links[count].length = length;
+            links[count].direction = d;
+            count++;
+        }
+    }
+    return count;
+}
+
+/* Function writeCorridor
+
+   Writes the rooms along a corridor into a path, the first room at a given
+   index and each room after it one index further forward or back
+
+   Input: *m - the maze
+          room - the room number the corridor is followed from
+          direction - the direction of the first step
+          length - the number of steps
+          *rooms - the rooms of the path
+          index - where the first room goes
+          delta - 1 to write forward and -1 to write backward
+
+   Output: Void
+*/
+static void writeCorridor(const struct maze *m, uint32_t room, int direction, uint32_t length,
+                          uint32_t *rooms, size_t index, int delta) {
+    const long step[4] = {1, -1, m->columns, -(long)m->columns};
+    int row = room / m->columns;
+    int column = room - (uint32_t)row * m->columns;
+    uint32_t i;
+    rooms[index] = room;
+    for(i = 0; i < length; i++)
+    {
+        if(i > 0)
+            direction = corridorExit(m, row, column, direction);
+        room += step[direction];
+        row += SouthNorthOffset[direction];
+        column += EastWestOffset[direction];
+        index += delta;
+        rooms[index] = room;
+    }
+}
+
+/* Adds a key to a binary min-heap */
+static inline void heapPush(uint64_t *heap, size_t *length, uint64_t key) {
+    size_t i = (*length)++;
+    while(i > 0 && heap[(i - 1) / 2] > key)
+    {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = key;
+}
+
+/* Removes and returns the least key of a binary min-heap */
+static inline uint64_t heapPop(uint64_t *heap, size_t *length) {
+    uint64_t top = heap[0];
+    uint64_t last = heap[--(*length)];
+    size_t i = 0, child;
+    while((child = 2 * i + 1) < *length)
+    {
+        if(child + 1 < *length && heap[child + 1] < heap[child])
+            child++;
+        if(heap[child] >= last)
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+/* Function edgeSource
+
+   Finds the junction an edge of a junction graph leaves from
+
+   Input: *g - the junction graph
+          edge - the edge number
+
+   Output: The junction number
+*/
+static uint32_t edgeSource(const struct junctionGraph *g, uint32_t edge) {
+    uint32_t low = 0, high = g->junctions - 1;
+    while(low < high)
+    {
+        uint32_t middle = low + (high - low + 1) / 2;
+        if(g->firstEdges[middle] <= edge)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+    return low;
+}
+
+/* Function junctionSolve
+
+   Finds a shortest path between two rooms by Dijkstra's algorithm over the
+   junction graph of the scratch memory, where every corridor is one edge
+   weighted by its length. The start and end join the graph through the
+   junctions at the ends of their corridors. A junction's parent entry marks
+   the link it was seeded from or that it has been expanded, the scratch queue
+   holds the edge it was reached by and the scratch steps its distance. The
+   search stops once no open junction can lead to a shorter path than the best
+   found, and the rooms are written out corridor by corridor at the distance
+   of each from the start. Junctions expanded count as rooms expanded.
+
+   Input: *m - the maze to search
+          startRow, startColumn - the room to start from
+          endRow, endColumn - the room to find a path to
+          *scratch - search scratch memory holding the junction graph
+          *path - where to store the path, from start to end
+
+   Output: 1 if a path was found, 0 if the end cannot be reached and -1 if out of memory or there is no graph
+*/
+int junctionSolve(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+                  struct solveScratch *scratch, struct solvePath *path) {
+    const struct junctionGraph *g = scratch->graph;
+    if(g == NULL || g->rows != m->rows || g->columns != m->columns)
+        return -1;
+    uint32_t start = (uint32_t)startRow * m->columns + startColumn;
+    uint32_t end = (uint32_t)endRow * m->columns + endColumn;
+    path->length = 0;
+    if(start == end)
+    {
+        if(reservePath(path, 1) == 0)
+            return -1;
+        path->rooms[path->length++] = start;
+        return 1;
+    }
+    size_t edges = g->firstEdges[g->junctions];
+    if(beginSearch(scratch, g->junctions) == 0)
+        return -1;
+    if(g->junctions > scratch->stepsCapacity)
+    {
+        uint32_t *steps = realloc(scratch->steps, g->junctions * sizeof(uint32_t));
+        if(steps == NULL)
+            return -1;
+        scratch->steps = steps;
+        scratch->stepsCapacity = g->junctions;
+    }
+    if(edges + 2 > scratch->heapCapacity)
+    {
+        uint64_t *heap = realloc(scratch->heap, (edges + 2) * sizeof(uint64_t));
+        if(heap == NULL)
+            return -1;
+        scratch->heap = heap;
+        scratch->heapCapacity = edges + 2;
+    }
+    uint32_t *steps = scratch->steps;
+    uint32_t *inEdges = scratch->queue;
+    uint64_t *heap = scratch->heap;
+    size_t heapLength = 0;
+
+    struct junctionLink startLinks[2], endLinks[2];
+    uint64_t best = UINT64_MAX;
+    int directDirection = 0, bestLink = -1;
+    int startCount = linkToJunctions(g, m, start, end, startLinks, &best, &directDirection);
+    int endCount = linkToJunctions(g, m, end, NO_JUNCTION, endLinks, &best, &directDirection);
+    int i;
+    for(i = 0; i < startCount; i++)
+    {
+        uint32_t j = startLinks[i].junction;
+        if(roomParent(scratch, j) != 0 && steps[j] <= startLinks[i].length)
+            continue;
+        storeRoomParent(scratch, j, PARENT_START | i);
+        steps[j] = startLinks[i].length;
+        heapPush(heap, &heapLength, (uint64_t)steps[j] << 32 | j);
+    }
+    while(heapLength > 0)
+    {
+        uint64_t key = heapPop(heap, &heapLength);
+        uint32_t j = (uint32_t)key;
+        uint64_t distance = key >> 32;
+        unsigned int parent = roomParent(scratch, j);
+        if(parent & PARENT_CLOSED)
+            continue;
+        if(distance >= best)
+            break;
+        storeRoomParent(scratch, j, parent | PARENT_CLOSED);
+        scratch->expanded++;
+        for(i = 0; i < endCount; i++)
+        {
+            if(endLinks[i].junction == j && distance + endLinks[i].length < best)
+            {
+                best = distance + endLinks[i].length;
+                bestLink = i;
+            }
+        }
+        uint32_t e;
+        for(e = g->firstEdges[j]; e < g->firstEdges[j + 1]; e++)
+        {
+            uint32_t next = g->edges[e].target;
+            uint64_t nextDistance = distance + g->edges[e].length;
+            unsigned int nextParent = roomParent(scratch, next);
+            if(nextDistance >= best || nextDistance > UINT32_MAX ||
+               (nextParent != 0 && ((nextParent & PARENT_CLOSED) || steps[next] <= nextDistance)))
+                continue;
+            storeRoomParent(scratch, next, PARENT_REACHED);
+            steps[next] = nextDistance;
+            inEdges[next] = e;
+            heapPush(heap, &heapLength, nextDistance << 32 | next);
+        }
+    }
+    if(best == UINT64_MAX)
+        return 0;
+
+    size_t length = best + 1;
+    if(reservePath(path, length) == 0)
+        return -1;
+    path->length = length;
+    if(bestLink < 0)
+    {
+        writeCorridor(m, start, directDirection, best, path->rooms, 0, 1);
+        return 1;
+    }
+    const struct junctionLink *link = &endLinks[bestLink];
+    if(link->direction >= 0)
+        writeCorridor(m, end, link->direction, link->length, path->rooms, length - 1, -1);
+    uint32_t j = link->junction;
+    while(!(roomParent(scratch, j) & PARENT_START))
+    {
+        uint32_t e = inEdges[j];
+        uint32_t source = edgeSource(g, e);
+        writeCorridor(m, g->rooms[source], g->directions[e], g->edges[e].length, path->rooms, steps[source], 1);
+        j = source;
+    }
+    link = &startLinks[PARENT_DIRECTION(roomParent(scratch, j))];
+    if(link->direction >= 0)
+        writeCorridor(m, start, link->direction, link->length, path->rooms, 0, 1);
+    return 1;
+}
+
+/* Rooms on a side of the square tiles that workers take in turn */
+#define FILL_TILE 256
+
+/* Open sides of a filled room: far above 4, so the decrements of its filled
+   neighbours never clear the top bit that marks it */
+#define SIDES_FILLED 0xc0
+#define ROOM_FILLED(sides) ((sides) & 0x80)
+
+/* Added to the open sides of a room that is a dead end from the start; these
+   are filled by the worker whose tile they lie in, every other room by the
+   worker that takes its open sides from 2 to 1 */
+#define SIDES_DEAD_END 0x40
+#define ROOM_DEAD_END(sides) (((sides) & 0xc0) == SIDES_DEAD_END)
+
+/* Added to the open sides of the start and end so they are never filled */
+#define SIDES_KEPT 8
+
+/* A dead-end filling shared by its workers, which take tiles of the maze
+   from nextTile: first to count the open sides of their rooms, then to fill
+   the dead ends among them */
+struct deadEndFill {
+    const struct maze *m;
+    _Atomic unsigned char *sides;
+    uint32_t start, end;
+    int tileColumns;
+    size_t tiles;
+    atomic_size_t nextTile;
+    atomic_size_t filled;   /* rooms filled by every worker */
+    atomic_int failed;      /* a worker ran out of memory */
+};
+
+/* Function linkedSides
+
+   Finds the sides of a room open to a neighbour inside the maze, in either
+   direction, so a wall only one of two rooms has still joins them. Reads the
+   room's own walls and the walls of its neighbours facing it.
+
+   Input: *m - the maze
+          row, column - the room
+
+   Output: The hex bits of its open sides
+*/
+static unsigned int linkedSides(const struct maze *m, int row, int column) {
+    unsigned int hexValue = roomHexValue(m, row, column);
+    unsigned int open = 0;
+    if(column + 1 < m->columns && (!(hexValue & EASTHEX) || !(roomHexValue(m, row, column + 1) & WESTHEX)))
+        open |= EASTHEX;
+    if(column > 0 && (!(hexValue & WESTHEX) || !(roomHexValue(m, row, column - 1) & EASTHEX)))
+        open |= WESTHEX;
+    if(row + 1 < m->rows && (!(hexValue & SOUTHHEX) || !(roomHexValue(m, row + 1, column) & NORTHHEX)))
+        open |= SOUTHHEX;
+    if(row > 0 && (!(hexValue & NORTHHEX) || !(roomHexValue(m, row - 1, column) & SOUTHHEX)))
+        open |= NORTHHEX;
+    return open;
+}
+
+/* Function takeFillTile
+
+   Takes the next tile of a dead-end filling
+
+   Input: *fill - the filling
+          *firstRow, *lastRow, *firstColumn, *lastColumn - set to the rooms of
+          the tile, the last ones excluded
+
+   Output: 1 if a tile was taken and 0 once there are none left
+*/
+static int takeFillTile(struct deadEndFill *fill, int *firstRow, int *lastRow, int *firstColumn, int *lastColumn) {
+    size_t tile = atomic_fetch_add_explicit(&fill->nextTile, 1, memory_order_relaxed);
+    if(tile >= fill->tiles)
+        return 0;
+    *firstRow = (int)(tile / fill->tileColumns) * FILL_TILE;
+    *firstColumn = (int)(tile % fill->tileColumns) * FILL_TILE;
+    *lastRow = *firstRow + FILL_TILE < fill->m->rows ? *firstRow + FILL_TILE : fill->m->rows;
+    *lastColumn = *firstColumn + FILL_TILE < fill->m->columns ? *firstColumn + FILL_TILE : fill->m->columns;
+    return 1;
+}
+
+/* Function countOpenSides
+
+   Worker storing the number of open sides of every room of the tiles it takes
+
+   Input: *arg - the deadEndFill
+          id - the worker number, unused
+
+   Output: Void
+*/
+static void countOpenSides(void *arg, int id) {
+    struct deadEndFill *fill = arg;
+    const struct maze *m = fill->m;
+    int firstRow, lastRow, firstColumn, lastColumn, row, column;
+    (void)id;
+    while(takeFillTile(fill, &firstRow, &lastRow, &firstColumn, &lastColumn))
+    {
+        for(row = firstRow; row < lastRow; row++)
+        {
+            uint32_t room = (uint32_t)row * m->columns + firstColumn;
+            for(column = firstColumn; column < lastColumn; column++, room++)
+            {
+                unsigned int sides = openSideCount(linkedSides(m, row, column));
+                if(room == fill->start || room == fill->end)
+                    sides += SIDES_KEPT;
+                else if(sides <= 1)
+                    sides += SIDES_DEAD_END;
+                atomic_store_explicit(&fill->sides[room], sides, memory_order_relaxed);
+            }
+        }
+    }
+}
+
+/* Function fillDeadEnds
+
+   Worker filling the dead ends of the tiles it takes. Filling a room closes
+   a side of each of its neighbours; one that becomes a dead end is filled
+   next, from a stack of this worker, wherever in the maze it lies. A room
+   becomes a dead end for exactly one worker, the one whose decrement leaves
+   it a single open side, so each room is filled once with no lock and no
+   more than one atomic operation per side.
+
+   Input: *arg - the deadEndFill
+          id - the worker number, unused
+
+   Output: Void
+*/
+static void fillDeadEnds(void *arg, int id) {
+    struct deadEndFill *fill = arg;
+    const struct maze *m = fill->m;
+    _Atomic unsigned char *sides = fill->sides;
+    const long step[4] = {1, -1, m->columns, -(long)m->columns};
+    size_t length, capacity = 256, filled = 0;
+    uint32_t *stack = malloc(capacity * sizeof(uint32_t));
+    int firstRow, lastRow, firstColumn, lastColumn, row, column;
+    (void)id;
+    if(stack == NULL)
+    {
+        atomic_store(&fill->failed, 1);
+        return;
+    }
+    while(takeFillTile(fill, &firstRow, &lastRow, &firstColumn, &lastColumn))
+    {
+        for(row = firstRow; row < lastRow; row++)
+        {
+            uint32_t seed = (uint32_t)row * m->columns + firstColumn;
+            for(column = firstColumn; column < lastColumn; column++, seed++)
+            {
+                if(!ROOM_DEAD_END(atomic_load_explicit(&sides[seed], memory_order_relaxed)))
+                    continue;
+                atomic_store_explicit(&sides[seed], SIDES_FILLED, memory_order_relaxed);
+                stack[0] = seed;
+                length = 1;
+                while(length > 0)
+                {
+                    uint32_t room = stack[--length];
+                    int roomRow = room / m->columns;
+                    unsigned int open = linkedSides(m, roomRow, room - (uint32_t)roomRow * m->columns);
+                    int d;
+                    filled++;
+                    if(capacity - length < 4)
+                    {
+                        size_t grown = capacity * 2;
+                        uint32_t *bigger = realloc(stack, grown * sizeof(uint32_t));
+                        if(bigger == NULL)
+                        {
+                            atomic_store(&fill->failed, 1);
+                            free(stack);
+                            return;
+                        }
+                        stack = bigger;
+                        capacity = grown;
+                    }
+                    for(d = 0; d < 4; d++)
+                    {
+                        if(!(open & DIRECTION_HEX(d)))
+                            continue;
+                        uint32_t next = room + step[d];
+                        if(atomic_fetch_sub_explicit(&sides[next], 1, memory_order_relaxed) == 2)
+                        {
+                            atomic_store_explicit(&sides[next], SIDES_FILLED, memory_order_relaxed);
+                            stack[length++] = next;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    free(stack);
+    atomic_fetch_add_explicit(&fill->filled, filled, memory_order_relaxed);
+}
+
+/* Function deadEndSolve
+
+   Finds a path between two rooms by dead-end filling: every room other than
+   the start and end with at most one open side is filled, which closes a side
+   of its neighbour, until no dead end is left. Workers of the scratch first
+   count the open sides of every room, then fill dead ends, taking tiles of
+   the maze in turn, and the rooms left hold every path from start to end
+   with nothing branching off. Only loops survive besides, so a breadth first
+   search of the rooms left reads off a shortest path, in a perfect maze by
+   walking it. Rooms filled and rooms searched count as rooms expanded.
+
+   Input: *m - the maze to search
+          startRow, startColumn - the room to start from
+          endRow, endColumn - the room to find a path to
+          *scratch - search scratch memory and the number of workers
+          *path - where to store the path, from start to end
+
+   Output: 1 if a path was found, 0 if the end cannot be reached and -1 if out of memory
+*/
+int deadEndSolve(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+                 struct solveScratch *scratch, struct solvePath *path) {
+    size_t rooms = (size_t)m->rows * m->columns;
+    if(beginSearch(scratch, rooms) == 0)
+        return -1;
+    if(rooms > scratch->sidesCapacity)
+    {
+        free((void *)scratch->sides);
+        scratch->sides = malloc(rooms);
+        scratch->sidesCapacity = scratch->sides != NULL ? rooms : 0;
+        if(scratch->sides == NULL)
+            return -1;
+    }
+    struct deadEndFill fill;
+    fill.m = m;
+    fill.sides = scratch->sides;
+    fill.start = (uint32_t)startRow * m->columns + startColumn;
+    fill.end = (uint32_t)endRow * m->columns + endColumn;
+    fill.tileColumns = (m->columns + FILL_TILE - 1) / FILL_TILE;
+    fill.tiles = (size_t)((m->rows + FILL_TILE - 1) / FILL_TILE) * fill.tileColumns;
+    atomic_init(&fill.filled, 0);
+    atomic_init(&fill.failed, 0);
+    int threads = scratch->threads > 0 ? scratch->threads : defaultThreadCount();
+    if((size_t)threads > fill.tiles)
+        threads = fill.tiles;
+    atomic_init(&fill.nextTile, 0);
+    if(runParallel(threads, countOpenSides, &fill) == 0)
+        return -1;
+    atomic_init(&fill.nextTile, 0);
+    if(runParallel(threads, fillDeadEnds, &fill) == 0 || atomic_load(&fill.failed))
+        return -1;
+    scratch->expanded += atomic_load(&fill.filled);
+
+    _Atomic unsigned char *sides = scratch->sides;
+    uint32_t *queue = scratch->queue;
+    const long step[4] = {1, -1, m->columns, -(long)m->columns};
+    size_t head = 0, tail = 0;
+    storeRoomParent(scratch, fill.start, PARENT_START);
+    path->length = 0;
+    queue[tail++] = fill.start;
+    while(head < tail)
+    {
+        uint32_t room = queue[head++];
+        scratch->expanded++;
+        if(room == fill.end)
+            return tracePath(m, scratch, fill.end, path) ? 1 : -1;
+        int row = room / m->columns;
+        int column = room - (uint32_t)row * m->columns;
+        unsigned int hexValue = roomHexValue(m, row, column);
+        int d;
+        for(d = 0; d < 4; d++)
+        {
+            if((hexValue & DIRECTION_HEX(d)) ||
+               roomOutOfBounds(row + SouthNorthOffset[d], column + EastWestOffset[d], m->columns, m->rows))
+                continue;
+            uint32_t next = room + step[d];
+            if(!ROOM_FILLED(atomic_load_explicit(&sides[next], memory_order_relaxed)) && roomParent(scratch, next) == 0)
+            {
+                storeRoomParent(scratch, next, PARENT_REACHED | OPPOSITE_DIRECTION(d));
+                queue[tail++] = next;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+#ifndef MAZESOLVE_H
+#define MAZESOLVE_H
+
+#include "common.h"
+#include "mazegraph.h"
+#include "mazeindex.h"
+
+/* Rooms are numbered row * columns + column, so a solvable maze has at most 2^32 - 1 rooms */
+#define MAX_SOLVE_ROOMS UINT32_MAX
+
+/* Working memory of a search, sized by the number of rooms and kept between
+   queries so it is reused: a FIFO of room numbers and a mark per room holding
+   the direction back to the room it was reached from. Marks are stamped with
+   the generation of the search that wrote them, so starting a query clears
+   nothing. A search costs exactly 8 bytes per room, known before it starts.
+   Engines that answer from an index or a junction graph of the maze find it
+   here; both are read-only and may be shared by many scratches. A search of
+   a junction graph holds junctions rather than rooms in the queue and marks,
+   and also needs the steps to each junction and a heap of open junctions.
+   Dead-end filling keeps a count of open sides per room, updated by several
+   workers at once, and may split one search across threads. */
+struct solveScratch {
+    uint32_t *queue;
+    uint32_t *marks;
+    uint32_t generation;    /* generation of the current search */
+    size_t capacity;        /* rooms the arrays hold */
+    size_t expanded;        /* rooms expanded by every search run with this scratch */
+    const struct mazeIndex *index;
+    const struct junctionGraph *graph;
+    uint32_t *steps;        /* steps from the start to each junction */
+    uint64_t *heap;         /* open junctions keyed by steps */
+    size_t stepsCapacity, heapCapacity;
+    _Atomic unsigned char *sides; /* open sides left to each room while filling dead ends */
+    size_t sidesCapacity;
+    int threads;            /* workers one search may run on, 0 for every processor */
+};
+
+/* Distance of a room that cannot be reached in a distance field */
+#define UNREACHED UINT32_MAX
+
+/* A path through a maze as the room numbers from start to end */
+struct solvePath {
+    uint32_t *rooms;
+    size_t length;
+    size_t capacity;
+};
+
+/* A path search between two rooms of a maze. solve stores the rooms of the
+   result in path and returns 1 if the end was reached, 0 if it cannot be
+   reached and -1 if out of memory. A full engine reports every room of the
+   search in the order it was entered, not only the path. */
+struct solveEngine {
+    const char *name;
+    const char *description;
+    int full;               /* output is FULL rather than PRUNED */
+    int usesIndex;          /* answers from the mazeIndex of its scratch */
+    int usesGraph;          /* searches the junctionGraph of its scratch */
+    int (*solve)(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+                 struct solveScratch *scratch, struct solvePath *path);
+};
+
+/* Every solver engine, ending with an entry whose name is NULL */
+extern const struct solveEngine solveEngines[];
+
+/* Looks up a solver engine by name */
+const struct solveEngine *findSolveEngine(const char *name);
+
+/* Grows search scratch memory to hold a maze of the given number of rooms */
+int reserveSolveScratch(struct solveScratch *scratch, size_t rooms);
+
+/* Releases search scratch memory */
+void freeSolveScratch(struct solveScratch *scratch);
+
+/* Releases the rooms of a path */
+void freeSolvePath(struct solvePath *path);
+
+/* Finds a shortest path between two rooms by breadth first search */
+int bfsSolve(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+             struct solveScratch *scratch, struct solvePath *path);
+
+/* Depth first search listing every room entered, in order */
+int dfsFullSolve(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+                 struct solveScratch *scratch, struct solvePath *path);
+
+/* Depth first search listing the path it found */
+int dfsPrunedSolve(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+                   struct solveScratch *scratch, struct solvePath *path);
+
+/* A* with a Manhattan heuristic on a two-bucket queue */
+int astarSolve(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+               struct solveScratch *scratch, struct solvePath *path);
+
+/* Breadth first search from both ends at once, stopping where they meet */
+int bidirectionalSolve(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+                       struct solveScratch *scratch, struct solvePath *path);
+
+/* Shortest path found by searching the junctions of a maze, with corridors as weighted edges */
+int junctionSolve(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+                  struct solveScratch *scratch, struct solvePath *path);
+
+/* Path left once dead ends are filled in parallel over tiles of the maze */
+int deadEndSolve(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+                 struct solveScratch *scratch, struct solvePath *path);
+
+/* Steps from one room to every room of a maze by breadth first search */
+size_t distanceField(const struct maze *m, int startRow, int startColumn, uint32_t *distances, uint32_t *farthest);
+
+/* Path between two rooms of a perfect maze through their lowest common ancestor */
+int lcaSolve(const struct maze *m, int startRow, int startColumn, int endRow, int endColumn,
+             struct solveScratch *scratch, struct solvePath *path);
+
+#endif
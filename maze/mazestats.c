@@ -0,0 +1,392 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "mazestats.h"
+#include "mazesolve.h"
+#include "parallel.h"
+
+/* Direction of the first open side in a set of hex bits, in the order east, west, south, north */
+static const signed char firstOpenDirection[16] = {-1, NORTH, SOUTH, SOUTH, WEST, WEST, WEST, WEST,
+                                                   EAST, EAST, EAST, EAST, EAST, EAST, EAST, EAST};
+
+/* The side state of a room while a tree is peeled: the hex bits of the sides
+   not yet peeled in the low 4 bits, whether the passage to its east or south
+   has been handed a branch across, and whether it starts as a dead end */
+#define SIDES_OPEN(sides) ((sides) & ALLWALLS)
+#define SIDES_EAST_HANDED 0x10
+#define SIDES_SOUTH_HANDED 0x20
+#define SIDES_DEAD_END 0x40
+
+/* The longest branch below a room while a tree is peeled: its length in the
+   high 32 bits and the room at its end in the low 32 */
+#define BRANCH(length, room) ((uint64_t)(length) << 32 | (room))
+#define BRANCH_LENGTH(branch) ((uint32_t)((branch) >> 32))
+#define BRANCH_END(branch) ((uint32_t)(branch))
+
+/* A count of rooms and corridors shared by its workers, which take bands of
+   rows from nextBand and each add up their own mazeStats. The count also
+   readies every room for peeling, which the same workers then do. */
+struct roomCount {
+    const struct maze *m;
+    int bands;
+    atomic_int nextBand;
+    struct mazeStats *counts; /* one per worker */
+    _Atomic unsigned char *sides;
+    _Atomic uint64_t *branches;
+};
+
+/* Function openSides
+
+   Finds the sides of a room its own walls leave open toward a room inside the maze.
+   Reads only the room's own walls, never its neighbours'.
+
+   Input: *m - the maze
+          row, column - the room
+
+   Output: The hex bits of its open sides
+*/
+static inline unsigned int openSides(const struct maze *m, int row, int column) {
+    unsigned int open = ~roomHexValue(m, row, column) & ALLWALLS;
+    if(column + 1 == m->columns)
+        open &= ~EASTHEX;
+    if(column == 0)
+        open &= ~WESTHEX;
+    if(row + 1 == m->rows)
+        open &= ~SOUTHHEX;
+    if(row == 0)
+        open &= ~NORTHHEX;
+    return open;
+}
+
+/* Function bucketOf
+
+   Finds the power-of-two bucket of a corridor length
+
+   Input: length - the length, at least 1
+
+   Output: The bucket, 0 for 1, 1 for 2-3, 2 for 4-7 and so on
+*/
+static inline int bucketOf(uint32_t length) {
+    return 31 - __builtin_clz(length);
+}
+
+/* Function measureCorridor
+
+   Walks a corridor from a room that is not a corridor room to the next room
+   that is not, entering only rooms that are open back toward the way they
+   were entered. Each corridor is walked from both ends and counted from the
+   end with the lower room number, or for a corridor leading back to the room
+   it left, from the side with the lower direction.
+
+   Input: *m - the maze
+          row, column - the room to start from
+          direction - the open side to leave it by
+          *count - the stats to add the corridor to
+
+   Output: Void
+*/
+static void measureCorridor(const struct maze *m, int row, int column, int direction, struct mazeStats *count) {
+    const int firstRow = row, firstColumn = column, firstDirection = direction;
+    uint32_t length = 0;
+    for(;;)
+    {
+        row += SouthNorthOffset[direction];
+        column += EastWestOffset[direction];
+        length++;
+        unsigned int open = openSides(m, row, column);
+        unsigned int back = DIRECTION_HEX(OPPOSITE_DIRECTION(direction));
+        if(openSideCount(open) != 2 || !(open & back))
+            break;
+        direction = firstOpenDirection[open & ~back];
+    }
+    if(row > firstRow || (row == firstRow && column > firstColumn) ||
+       (row == firstRow && column == firstColumn && firstDirection < OPPOSITE_DIRECTION(direction)))
+    {
+        count->corridors++;
+        count->corridorSteps += length;
+        count->corridorLengths[bucketOf(length)]++;
+        if(length > count->longestCorridor)
+            count->longestCorridor = length;
+    }
+}
+
+/* Function countRooms
+
+   Worker counting the open sides of the rooms of the bands it takes, the
+   passages and one-way walls to their east and south, and the corridors
+   leaving every room that is not a corridor room. Each room's side state
+   and branch are set for peeling as it is counted.
+
+   Input: *arg - the roomCount
+          id - the worker number, which picks its stats
+
+   Output: Void
+*/
+static void countRooms(void *arg, int id) {
+    struct roomCount *c = arg;
+    const struct maze *m = c->m;
+    struct mazeStats *count = &c->counts[id];
+    int band;
+    while((band = atomic_fetch_add_explicit(&c->nextBand, 1, memory_order_relaxed)) < c->bands)
+    {
+        int row, lastRow = (band + 1) * PARALLEL_BAND_ROWS < m->rows ? (band + 1) * PARALLEL_BAND_ROWS : m->rows;
+        for(row = band * PARALLEL_BAND_ROWS; row < lastRow; row++)
+        {
+            int column;
+            for(column = 0; column < m->columns; column++)
+            {
+                unsigned int hexValue = roomHexValue(m, row, column);
+                unsigned int open = openSides(m, row, column);
+                int sides = openSideCount(open);
+                uint32_t room = (uint32_t)row * m->columns + column;
+                count->degrees[sides]++;
+                atomic_store_explicit(&c->sides[room], open | (sides <= 1 ? SIDES_DEAD_END : 0), memory_order_relaxed);
+                atomic_store_explicit(&c->branches[room], BRANCH(0, room), memory_order_relaxed);
+                if(column + 1 < m->columns)
+                {
+                    unsigned int eastWall = roomHexValue(m, row, column + 1) & WESTHEX;
+                    count->passages += !(hexValue & EASTHEX) || !eastWall;
+                    count->oneWayWalls += !(hexValue & EASTHEX) != !eastWall;
+                }
+                if(row + 1 < m->rows)
+                {
+                    unsigned int southWall = roomHexValue(m, row + 1, column) & NORTHHEX;
+                    count->passages += !(hexValue & SOUTHHEX) || !southWall;
+                    count->oneWayWalls += !(hexValue & SOUTHHEX) != !southWall;
+                }
+                if(sides == 2)
+                    continue;
+                while(open != 0)
+                {
+                    int d = firstOpenDirection[open];
+                    open &= ~DIRECTION_HEX(d);
+                    measureCorridor(m, row, column, d, count);
+                }
+            }
+        }
+    }
+}
+
+/* Function handBranch
+
+   Hands the longest branch below a room across a passage to its neighbour,
+   which keeps the longer of it and its own. The two branches joined at the
+   neighbour are a path, kept in the stats if it is the longest seen.
+
+   Input: *c - the roomCount
+          room - the room handing its branch on
+          next - the neighbour across the passage
+          *count - the stats of this worker
+
+   Output: Void
+*/
+static void handBranch(struct roomCount *c, uint32_t room, uint32_t next, struct mazeStats *count) {
+    uint64_t branch = atomic_load_explicit(&c->branches[room], memory_order_acquire);
+    uint64_t handed = BRANCH(BRANCH_LENGTH(branch) + 1, BRANCH_END(branch));
+    uint64_t own = atomic_load_explicit(&c->branches[next], memory_order_acquire);
+    for(;;)
+    {
+        uint32_t joined = BRANCH_LENGTH(own) + BRANCH_LENGTH(handed);
+        if(joined > count->diameter)
+        {
+            count->diameter = joined;
+            count->diameterEnds[0] = BRANCH_END(own);
+            count->diameterEnds[1] = BRANCH_END(handed);
+        }
+        if(BRANCH_LENGTH(handed) <= BRANCH_LENGTH(own) ||
+           atomic_compare_exchange_weak_explicit(&c->branches[next], &own, handed,
+                                                 memory_order_acq_rel, memory_order_acquire))
+            break;
+    }
+}
+
+/* Function peelRooms
+
+   Worker peeling a tree from its dead ends in the bands it takes, which
+   finds its longest path in one pass. A room with one side left hands its
+   longest branch across it and the side is peeled from the neighbour; the
+   neighbour left with one side is peeled next, from a stack of this worker,
+   wherever in the maze it lies. A room's branch is complete once it is down
+   to one side, since every other neighbour handed its own first. Only the
+   worker whose peel leaves a room one side claims it, and the flag of each
+   passage lets only one of the last two rooms hand across it, so nothing is
+   locked. Rooms on a loop are never peeled.
+
+   Input: *arg - the roomCount
+          id - the worker number, which picks its stats
+
+   Output: Void
+*/
+static void peelRooms(void *arg, int id) {
+    struct roomCount *c = arg;
+    const struct maze *m = c->m;
+    struct mazeStats *count = &c->counts[id];
+    _Atomic unsigned char *sides = c->sides;
+    const long step[4] = {1, -1, m->columns, -(long)m->columns};
+    size_t length, capacity = 256;
+    uint32_t *stack = malloc(capacity * sizeof(uint32_t));
+    int band;
+    if(stack == NULL)
+    {
+        count->reached = UINT64_MAX;
+        return;
+    }
+    while((band = atomic_fetch_add_explicit(&c->nextBand, 1, memory_order_relaxed)) < c->bands)
+    {
+        int lastRow = (band + 1) * PARALLEL_BAND_ROWS < m->rows ? (band + 1) * PARALLEL_BAND_ROWS : m->rows;
+        uint32_t seed = (uint32_t)band * PARALLEL_BAND_ROWS * m->columns;
+        uint32_t end = (uint32_t)lastRow * m->columns;
+        for(; seed < end; seed++)
+        {
+            if(!(atomic_load_explicit(&sides[seed], memory_order_relaxed) & SIDES_DEAD_END))
+                continue;
+            stack[0] = seed;
+            length = 1;
+            while(length > 0)
+            {
+                uint32_t room = stack[--length];
+                unsigned int open = SIDES_OPEN(atomic_load_explicit(&sides[room], memory_order_acquire));
+                count->reached++;
+                if(open == 0)
+                    continue;
+                int d = firstOpenDirection[open];
+                uint32_t next = room + step[d];
+                uint32_t owner = (d == EAST || d == SOUTH) ? room : next;
+                unsigned char handed = (d == EAST || d == WEST) ? SIDES_EAST_HANDED : SIDES_SOUTH_HANDED;
+                if(atomic_fetch_or_explicit(&sides[owner], handed, memory_order_acq_rel) & handed)
+                    continue;
+                handBranch(c, room, next, count);
+                unsigned char before = atomic_fetch_and_explicit(&sides[next],
+                                                                 ~DIRECTION_HEX(OPPOSITE_DIRECTION(d)), memory_order_acq_rel);
+                if(openSideCount(SIDES_OPEN(before)) != 2)
+                    continue;
+                if(length == capacity)
+                {
+                    uint32_t *bigger = realloc(stack, capacity * 2 * sizeof(uint32_t));
+                    if(bigger == NULL)
+                    {
+                        count->reached = UINT64_MAX;
+                        free(stack);
+                        return;
+                    }
+                    stack = bigger;
+                    capacity *= 2;
+                }
+                stack[length++] = next;
+            }
+        }
+    }
+    free(stack);
+}
+
+/* Function analyzeMaze
+
+   Measures a maze in a fixed number of passes. Workers count the rooms by
+   open sides, the passages, one-way walls and corridors a band of rows at a
+   time, with a total of their own added up at the end; corridors are walked
+   from their ends, so each room is read a bounded number of times. When the
+   passages and walls fit a tree, the workers then peel it from its dead ends,
+   which finds its longest path; if every room is peeled the maze is perfect
+   and the path is its diameter. Otherwise two breadth first searches find
+   the diameter, the second from the room farthest from (0, 0).
+
+   Input: *m - the maze
+          threads - the number of workers, 0 for every processor
+          *stats - set to the measures of the maze
+
+   Output: 1 if the maze was measured and 0 if out of memory or the maze is too large
+*/
+int analyzeMaze(const struct maze *m, int threads, struct mazeStats *stats) {
+    size_t rooms = (size_t)m->rows * m->columns;
+    memset(stats, 0, sizeof(*stats));
+    if(rooms > MAX_SOLVE_ROOMS)
+        return 0;
+    struct roomCount c;
+    c.m = m;
+    c.bands = (m->rows + PARALLEL_BAND_ROWS - 1) / PARALLEL_BAND_ROWS;
+    if(threads <= 0)
+        threads = defaultThreadCount();
+    if(threads > c.bands)
+        threads = c.bands;
+    c.counts = calloc(threads, sizeof(struct mazeStats));
+    c.sides = malloc(rooms);
+    c.branches = malloc(rooms * sizeof(uint64_t));
+    int i, d, b, peeled = 0;
+    atomic_init(&c.nextBand, 0);
+    if(c.counts == NULL || c.sides == NULL || c.branches == NULL || runParallel(threads, countRooms, &c) == 0)
+        goto failed;
+    for(i = 0; i < threads; i++)
+    {
+        const struct mazeStats *count = &c.counts[i];
+        stats->passages += count->passages;
+        stats->oneWayWalls += count->oneWayWalls;
+        for(d = 0; d < 5; d++)
+            stats->degrees[d] += count->degrees[d];
+        stats->corridors += count->corridors;
+        stats->corridorSteps += count->corridorSteps;
+        for(b = 0; b < CORRIDOR_BUCKETS; b++)
+            stats->corridorLengths[b] += count->corridorLengths[b];
+        if(count->longestCorridor > stats->longestCorridor)
+            stats->longestCorridor = count->longestCorridor;
+    }
+    stats->rooms = rooms;
+
+    if(stats->oneWayWalls == 0 && stats->passages == rooms - 1)
+    {
+        atomic_init(&c.nextBand, 0);
+        if(runParallel(threads, peelRooms, &c) == 0)
+            goto failed;
+        for(i = 0; i < threads; i++)
+        {
+            const struct mazeStats *count = &c.counts[i];
+            if(count->reached == UINT64_MAX)
+                goto failed;
+            stats->reached += count->reached;
+            if(count->diameter > stats->diameter || i == 0)
+            {
+                stats->diameter = count->diameter;
+                stats->diameterEnds[0] = count->diameterEnds[0];
+                stats->diameterEnds[1] = count->diameterEnds[1];
+            }
+        }
+        /* a tree of as many passages as rooms less one has every room peeled */
+        peeled = stats->reached == rooms;
+    }
+    free(c.counts);
+    free((void *)c.sides);
+    free((void *)c.branches);
+    stats->perfect = peeled;
+    if(peeled)
+        return 1;
+
+    uint32_t *distances = malloc(rooms * sizeof(uint32_t));
+    uint32_t farthest;
+    if(distances == NULL || (stats->reached = distanceField(m, 0, 0, distances, &farthest)) == 0)
+    {
+        free(distances);
+        return 0;
+    }
+    /* with one-way walls the second search may reach less than the first */
+    uint32_t first = farthest;
+    stats->diameter = distances[first];
+    stats->diameterEnds[1] = first;
+    if(distanceField(m, first / m->columns, first % m->columns, distances, &farthest) == 0)
+    {
+        free(distances);
+        return 0;
+    }
+    if(distances[farthest] > stats->diameter)
+    {
+        stats->diameter = distances[farthest];
+        stats->diameterEnds[0] = first;
+        stats->diameterEnds[1] = farthest;
+    }
+    free(distances);
+    return 1;
+
+failed:
+    free(c.counts);
+    free((void *)c.sides);
+    free((void *)c.branches);
+    return 0;
+}
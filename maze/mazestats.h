@@ -0,0 +1,36 @@
+#ifndef MAZESTATS_H
+#define MAZESTATS_H
+
+#include "common.h"
+
+/* Corridor lengths are counted in power-of-two buckets: 1, 2-3, 4-7, ... */
+#define CORRIDOR_BUCKETS 33
+
+/* Measures of a maze used to grade its difficulty. Open sides are those a
+   room's own walls leave open toward a neighbour inside the maze. A dead end
+   has one open side and a junction three or four; a corridor is the run of
+   rooms with two open sides between two rooms that have not, measured in
+   steps, so two junctions side by side are joined by a corridor of 1. Where
+   walls disagree a corridor may be walked from one end only and go uncounted.
+   The diameter of a perfect maze is its longest path; otherwise it is the
+   longer of two breadth first searches, from room (0, 0) and from the room
+   farthest from it, a lower bound within the rooms reached. */
+struct mazeStats {
+    uint64_t rooms;
+    uint64_t passages;      /* open sides between rooms, each pair counted once */
+    uint64_t oneWayWalls;   /* walls only one of two neighbours has */
+    uint64_t degrees[5];    /* rooms by number of open sides */
+    uint64_t corridors;
+    uint64_t corridorSteps; /* steps of all corridors */
+    uint32_t longestCorridor;
+    uint64_t corridorLengths[CORRIDOR_BUCKETS];
+    uint64_t reached;       /* rooms reached from room (0, 0) */
+    int perfect;            /* every room reached by exactly one path */
+    uint32_t diameter;
+    uint32_t diameterEnds[2]; /* room numbers of the ends of the diameter */
+};
+
+/* Measures a maze, counting rooms and corridors on a number of threads */
+int analyzeMaze(const struct maze *m, int threads, struct mazeStats *stats);
+
+#endif
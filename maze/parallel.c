@@ -0,0 +1,85 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "parallel.h"
+
+/* Arguments handed to one worker thread */
+struct workerArgs {
+    parallelWorker worker;
+    void *arg;
+    int id;
+};
+
+/* Function startWorker
+
+   Thread entry point that unpacks a workerArgs and runs its worker
+
+   Input: *p - pointer to the workerArgs of this thread
+
+   Output: NULL
+*/
+static void *startWorker(void *p) {
+    struct workerArgs *w = p;
+    w->worker(w->arg, w->id);
+    return NULL;
+}
+
+/* Function runParallel
+
+   Runs a worker function on a number of threads and waits for all of them to
+   finish. Workers share arg and split the work among themselves, usually by
+   taking items from an atomic counter. The calling thread runs worker 0, so a
+   single thread never starts a pthread.
+
+   Input: threads - the number of workers to run
+          worker - the function each worker runs
+          *arg - the argument passed to every worker
+
+   Output: 1 once every worker has run and 0 if out of memory
+*/
+int runParallel(int threads, parallelWorker worker, void *arg) {
+    if(threads < 1)
+        threads = 1;
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    struct workerArgs *args = malloc(threads * sizeof(struct workerArgs));
+    if(tids == NULL || args == NULL)
+    {
+        free(tids);
+        free(args);
+        return 0;
+    }
+    int i, started;
+    for(i = 0; i < threads; i++)
+    {
+        args[i].worker = worker;
+        args[i].arg = arg;
+        args[i].id = i;
+    }
+    for(started = 1; started < threads; started++)
+    {
+        if(pthread_create(&tids[started], NULL, startWorker, &args[started]) != 0)
+            break;
+    }
+    /* run the first worker here, then the work of any thread that failed to start */
+    worker(arg, 0);
+    for(i = started; i < threads; i++)
+        worker(arg, i);
+    for(i = 1; i < started; i++)
+        pthread_join(tids[i], NULL);
+    free(tids);
+    free(args);
+    return 1;
+}
+
+/* Function defaultThreadCount
+
+   Number of processors currently online
+
+   Input: Void
+
+   Output: The processor count, at least 1
+*/
+int defaultThreadCount(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n < 1 ? 1 : (int)n;
+}
@@ -0,0 +1,16 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+/* Rows of the bands of a maze that workers take in turn */
+#define PARALLEL_BAND_ROWS 16
+
+/* Work function run on each worker thread; id is 0..threads-1 */
+typedef void (*parallelWorker)(void *arg, int id);
+
+/* Runs worker on the given number of threads and waits for all of them */
+int runParallel(int threads, parallelWorker worker, void *arg);
+
+/* Number of processors available to run workers on */
+int defaultThreadCount(void);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/* State of a xoshiro256** pseudo random number generator. Each thread owns its
+   own state, so streams never contend and are reproducible from their seed.
+   Single random bits are served from a buffered 64-bit draw. */
+struct rng {
+    uint64_t s[4];
+    uint64_t bits;
+    int bitsLeft;
+};
+
+/* Next output of the splitmix64 sequence, used to expand seeds */
+static inline uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+/* Seeds a generator with stream number stream of a seed; streams of one seed are independent */
+static inline void rngSeed(struct rng *g, uint64_t seed, uint64_t stream) {
+    uint64_t x = seed ^ splitmix64(&stream);
+    int i;
+    for(i = 0; i < 4; i++)
+        g->s[i] = splitmix64(&x);
+    g->bits = 0;
+    g->bitsLeft = 0;
+}
+
+/* Next 64 random bits */
+static inline uint64_t rngNext(struct rng *g) {
+    uint64_t *s = g->s;
+    uint64_t x = s[1] * 5;
+    uint64_t result = ((x << 7) | (x >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return result;
+}
+
+/* Uniform random number in 0..n-1 without modulo bias (Lemire's method), n > 0 */
+static inline uint32_t rngBounded(struct rng *g, uint32_t n) {
+    uint64_t m = (rngNext(g) >> 32) * n;
+    if((uint32_t)m < n)
+    {
+        uint32_t threshold = -n % n;
+        while((uint32_t)m < threshold)
+            m = (rngNext(g) >> 32) * n;
+    }
+    return (uint32_t)(m >> 32);
+}
+
+/* A single random bit */
+static inline int rngBit(struct rng *g) {
+    if(g->bitsLeft == 0)
+    {
+        g->bits = rngNext(g);
+        g->bitsLeft = 64;
+    }
+    g->bitsLeft--;
+    int bit = g->bits & 1;
+    g->bits >>= 1;
+    return bit;
+}
+
+#endif
@@ -1,79 +1,310 @@
 /* CS033 HW 02 - Maze Solver
  
 Solves a maze. A path from the starting coordinate to the ending coordinate is determined
-using depth first search. FULL or PRUNED Output is written to a file. */
+by a solver engine chosen at run time. FULL or PRUNED Output is written to a file.
+The other modes (--queries, --distances, --stats, --validate) are described in the usage text. */
 
 #include <stdio.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <time.h>
 #include <string.h>
+#include <getopt.h>
+#include <stdatomic.h>
 #include "common.h"
+#include "mazeio.h"
+#include "mazecheck.h"
+#include "mazesolve.h"
+#include "mazestats.h"
+#include "parallel.h"
 
-/* A linked list that internally stores the row and column of rooms */
-struct linkedlist {
-    int row, column;
-    struct linkedlist *next;
+/* Queries read at a time and answered in parallel before their answers are written */
+#define QUERY_BLOCK 4096
+
+/* Outcomes of a query besides those of a solver engine (1 found, 0 no path, -1 out of memory) */
+#define QUERY_OUTSIDE -2
+#define QUERY_MALFORMED -3
+
+/* Path output formats */
+#define PATH_TEXT 0         /* one "row, column" line per room */
+#define PATH_RLE 1          /* "row, column" of a segment's first room, then its run-length-encoded steps */
+#define PATH_PACKED 2       /* pathFileHeader, then a pathRecordHeader per answer and its segments */
+#define PATH_DISTANCE 3     /* one line per answer, the steps of the path or -1 without one */
+
+/* Characters a text streaming to a writer collects before handing them over */
+#define PATH_STREAM_SIZE (64 * 1024)
+
+/* Widths in bytes of the distances of a distance field file, a raw array of
+   the steps from the starting room to every room in row-major order, in host
+   byte order. A room with no path from the start is all ones, and in a uint16
+   field a room farther than DISTANCE16_MAX steps is written as DISTANCE16_MAX. */
+#define DISTANCE_UINT16 2
+#define DISTANCE_UINT32 4
+#define DISTANCE16_MAX 0xfffe
+
+/* Identifies packed path files */
+#define PATH_MAGIC "MAZP"
+#define PATH_FORMAT_VERSION 1
+
+/* Header of a packed path file, in host byte order. Each answer follows as a
+   pathRecordHeader and the segments holding its rooms: a segment is a
+   pathSegmentHeader and the directions of its steps from the first room, 2
+   bits each (0 east, 1 west, 2 south, 3 north), four to a byte, the first step
+   in the low bits. A new segment starts wherever a room is not next to the one
+   before it, as in a FULL listing where the search backtracked. */
+struct pathFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t rows;
+    uint32_t columns;
+};
+
+struct pathRecordHeader {
+    uint32_t full;          /* rooms are a FULL listing rather than a PRUNED path */
+    uint32_t rooms;         /* rooms in all segments of the answer, 0 without a path */
+};
+
+struct pathSegmentHeader {
+    uint32_t row;
+    uint32_t column;
+    uint32_t steps;
+};
+
+/* A start/end query of a query stream and how it was answered: its answer is
+   length characters at offset in the text arena of the worker that answered it */
+struct query {
+    int startRow, startColumn, endRow, endColumn;
+    size_t lineNumber;
+    int status;
+    int worker;
+    size_t offset, length;
+};
+
+/* A bump arena of answer text. Answers are appended one after another and
+   released together by setting length back to 0, so formatting makes no heap
+   call beyond growing the arena, which keeps its memory for the next answers.
+   A text with a sink is a fixed buffer streaming to a writer instead: it is
+   handed to the sink whenever it fills, so a path of any length is written
+   without being held whole. */
+struct pathText {
+    char *text;
+    size_t length, capacity;
+    struct mazeWriter *sink;
 };
 
-/* Traverses and prints the linked list to a file */
-void printLL(struct linkedlist *alos, FILE *fileName);
+/* A block of queries answered by a pool of workers. The maze, index and graph are
+   shared read-only; every worker has its own scratch memory, path and text
+   arena, so workers never contend. */
+struct queryBlock {
+    const struct maze *maze;
+    const struct solveEngine *engine;
+    int format;
+    struct query *queries;
+    struct pathText *arenas;
+    size_t count;
+    atomic_size_t nextQuery;
+    struct solveScratch *scratches;
+    struct solvePath *paths;
+};
+
+/* Appends the result of a search to a text in an output format */
+int formatPath(struct pathText *t, const struct maze *maze, const struct solveEngine *engine, int format, const struct solvePath *path);
+
+/* Finds the steps of the path between two rooms, from an index without building the path */
+int solveDistance(const struct maze *maze, const struct solveEngine *engine, int startRow, int startColumn, int endRow, int endColumn,
+                  struct solveScratch *scratch, struct solvePath *path, uint32_t *steps);
+
+/* Appends the steps of a path to a text as a line */
+int formatDistance(struct pathText *t, int found, uint32_t steps);
+
+/* Writes what comes before the answers in an output format */
+void writePathHeader(struct mazeWriter *w, int format, int rows, int columns);
+
+/* Answers the queries of a block taken from a shared counter */
+void answerQueries(void *arg, int id);
 
 /* Solves a maze from input file for the requested coordinates and outputs to file */
-void solveMaze(char *mazeFileName, char *outputFileName, int startColumn, int startRow, int endColumn, int endRow);
+void solveMaze(char *mazeFileName, int rows, int columns, char *outputFileName, const struct solveEngine *engine,
+               int format, int startColumn, int startRow, int endColumn, int endRow, int threads, int timed);
 
-/* Reads in a maze from a file */
-int readMaze(struct room maze [MAZE_ROWS][MAZE_COLUMNS], char *fileName);
+/* Writes the steps from one room to every room of a maze */
+void writeDistanceField(char *mazeFileName, int rows, int columns, char *outputFileName, int width,
+                        int startRow, int startColumn, int timed);
+
+/* Writes a report of the measures of a maze */
+void writeMazeStats(char *mazeFileName, int rows, int columns, char *outputFileName, int threads, int timed);
+
+/* Writes a report of the check of a maze */
+int writeMazeCheck(char *mazeFileName, int rows, int columns, char *outputFileName, int threads, int timed);
+
+/* Solves a stream of queries against a maze loaded once */
+void solveQueries(char *mazeFileName, int rows, int columns, char *outputFileName, const struct solveEngine *engine,
+                  int format, char *queryFileName, int threads, int timed);
 
-/* Performs depth first search and outputs to a file with FULL output */
-int fullDFS(int row, int column, struct room maze [MAZE_ROWS][MAZE_COLUMNS], int targetRow, int targetCol, struct linkedlist *last);
+/* Reads in a maze from a file */
+int readMaze(struct maze *maze, char *fileName, int rows, int columns);
 
-/* Performs depth first search and outputs to a file with PRUNED output */
-int prunedDFS(int row, int column, struct room maze [MAZE_ROWS][MAZE_COLUMNS], int targetRow, int targetCol, struct linkedlist *previous);
+/* Reads in a maze, or the index of it an engine answers from, and the junction graph an engine searches */
+void loadMaze(struct maze *maze, struct mazeIndex *index, struct junctionGraph *graph, const struct solveEngine *engine,
+              char *fileName, int rows, int columns);
 
-/* Determines whether a room has an open connection in a given direction */
-int roomHasOpenConnection(struct room r, int direction);
+/* Reports on stderr how long a step took */
+void reportTime(const char *step, double count, const char *unit, const struct timespec *start);
 
-/* Creates and initializes a room from hexValue at a given location */
-struct room createRoomFromHexValue(unsigned int hexValue, int row, int column);
+/* Lists the solver engines with their descriptions */
+void listEngines(FILE *fp);
 
 /* Function main
 
-   This function is where the program begins. Calls solveMaze to solve the maze or outputs
-   an error message if parameters are invalid.
+   This function is where the program begins. Calls solveMaze to solve the maze, solveQueries
+   when --queries is given, writeDistanceField when --distances is given, writeMazeStats
+   when --stats is given, writeMazeCheck when --validate is given, or outputs an error
+   message if parameters are invalid.
 
    Input: int argc - The number of program arguments, including the executable name
           char **argv - An array of strings containing the program arguments
  
-   Output: 0 upon completion of the program
+   Output: 0 upon completion of the program, 1 if --validate found the maze is not perfect
  */
 int main(int argc, char **argv) {
-    if(argc < 7)
+    static struct option options[] = {
+        {"engine", required_argument, NULL, 'e'},
+        {"queries", required_argument, NULL, 'q'},
+        {"threads", required_argument, NULL, 'j'},
+        {"time", no_argument, NULL, 't'},
+        {"format", required_argument, NULL, 'f'},
+        {"distances", required_argument, NULL, 'd'},
+        {"stats", no_argument, NULL, 's'},
+        {"validate", no_argument, NULL, 'v'},
+        {NULL, 0, NULL, 0}
+    };
+    const struct solveEngine *engine = &solveEngines[0];
+    char *queryFile = NULL;
+    int threads = 0;        /* 0 until --threads is given */
+    int timed = 0;
+    int format = PATH_TEXT;
+    int distanceWidth = 0;  /* 0 unless --distances is given */
+    int stats = 0;
+    int validate = 0;
+    int opt;
+    while((opt = getopt_long(argc, argv, "e:q:j:tf:d:sv", options, NULL)) != -1)
+    {
+        switch(opt)
+        {
+            case 'e':
+                engine = findSolveEngine(optarg);
+                if(engine == NULL)
+                {
+                    fprintf(stderr, "Unknown engine %s, expected one of:\n", optarg);
+                    listEngines(stderr);
+                    exit(0);
+                }
+                break;
+            case 'q':
+                queryFile = optarg;
+                break;
+            case 'j':
+                threads = atoi(optarg);
+                if(threads <= 0)
+                    threads = defaultThreadCount();
+                break;
+            case 't':
+                timed = 1;
+                break;
+            case 'f':
+                if(strcmp(optarg, "text") == 0)
+                    format = PATH_TEXT;
+                else if(strcmp(optarg, "rle") == 0)
+                    format = PATH_RLE;
+                else if(strcmp(optarg, "packed") == 0)
+                    format = PATH_PACKED;
+                else if(strcmp(optarg, "distance") == 0)
+                    format = PATH_DISTANCE;
+                else
+                {
+                    fprintf(stderr, "Unknown format %s, expected text, rle, packed or distance\n", optarg);
+                    exit(0);
+                }
+                break;
+            case 'd':
+                if(strcmp(optarg, "uint32") == 0)
+                    distanceWidth = DISTANCE_UINT32;
+                else if(strcmp(optarg, "uint16") == 0)
+                    distanceWidth = DISTANCE_UINT16;
+                else
+                {
+                    fprintf(stderr, "Unknown distance type %s, expected uint32 or uint16\n", optarg);
+                    exit(0);
+                }
+                break;
+            case 's':
+                stats = 1;
+                break;
+            case 'v':
+                validate = 1;
+                break;
+            default:
+                exit(0);
+        }
+    }
+    argc -= optind - 1;
+    argv += optind - 1;
+    if(argc < (queryFile != NULL || stats || validate ? 5 : distanceWidth != 0 ? 7 : 9))
     {
-        printf("Usage: %s <input maze file> <number of rows> <number of columns> <output solution file> <starting row> <starting column> <ending row> <ending column>\n", argv[0]);
+        printf("Usage: %s [--engine <name>] [--threads <n, 0 for all cores>] [--format text|rle|packed|distance] [--time] <input maze file> <number of rows> <number of columns> <output solution file> <starting row> <starting column> <ending row> <ending column>\n", argv[0]);
+        printf("       %s --queries <query file, - for stdin> [--threads <n, 0 for all cores>] [--engine <name>] [--format text|rle|packed|distance] [--time] <input maze file> <number of rows> <number of columns> <output solution file, - for stdout>\n", argv[0]);
+        printf("       %s --distances uint32|uint16 [--time] <input maze file> <number of rows> <number of columns> <output distance file, - for stdout> <starting row> <starting column>\n", argv[0]);
+        printf("       %s --stats [--threads <n, 0 for all cores>] [--time] <input maze file> <number of rows> <number of columns> <output report file, - for stdout>\n", argv[0]);
+        printf("       %s --validate [--threads <n, 0 for all cores>] [--time] <input maze file> <number of rows> <number of columns> <output report file, - for stdout>\n", argv[0]);
+        printf("Engines:\n");
+        listEngines(stdout);
         exit(0);
     }
     
     char *inputFile = strdup(argv[1]);
     char *outputFile = strdup(argv[4]);
-    MAZE_ROWS = atoi(argv[2]);
-    MAZE_COLUMNS = atoi(argv[3]);
-    int startingRow = atoi(argv[5]);
-    int startingColumn = atoi(argv[6]);
-    int endingRow = atoi(argv[7]);
-    int endingColumn = atoi(argv[8]);
+    int rows = atoi(argv[2]);
+    int columns = atoi(argv[3]);
     
+    if(format == PATH_DISTANCE && engine->full)
+    {
+        fprintf(stderr, "%s lists every room entered, not a path to measure\n", engine->name);
+        exit(0);
+    }
     if(inputFile == NULL || outputFile == NULL)
     {
         fprintf(stderr,"Input/Output files must be provided\n");
         exit(0);
     }
-    if(MAZE_ROWS == 0 || MAZE_COLUMNS == 0)
+    if(rows <= 0 || columns <= 0)
     {
         fprintf(stderr, "Maze Rows/Columns must be non-zero\n");
         exit(0);
     }
-    if(startingRow < 0 || startingColumn < 0 || startingRow > endingRow || startingColumn > endingColumn)
+    if(validate)
+        return writeMazeCheck(inputFile, rows, columns, outputFile, threads, timed) ? 0 : 1;
+    if(stats)
+    {
+        writeMazeStats(inputFile, rows, columns, outputFile, threads, timed);
+        return 0;
+    }
+    if(queryFile != NULL)
+    {
+        solveQueries(inputFile, rows, columns, outputFile, engine, format, queryFile, threads > 0 ? threads : 1, timed);
+        return 0;
+    }
+
+    int startingRow = atoi(argv[5]);
+    int startingColumn = atoi(argv[6]);
+    if(distanceWidth != 0)
+    {
+        writeDistanceField(inputFile, rows, columns, outputFile, distanceWidth, startingRow, startingColumn, timed);
+        return 0;
+    }
+    int endingRow = atoi(argv[7]);
+    int endingColumn = atoi(argv[8]);
+    if(startingRow < 0 || startingColumn < 0)
     {
         fprintf(stderr, "Error with strting row/column\n");
         exit(0);
@@ -87,341 +318,942 @@ int main(int argc, char **argv) {
     #ifdef DEBUG
         printf("main: starting row = %d, sc = %d, er = %d ec = %d\n", startingRow, startingColumn, endingRow, endingColumn);
     #endif
-    solveMaze(inputFile, outputFile, startingColumn, startingRow, endingColumn, endingRow);
+    solveMaze(inputFile, rows, columns, outputFile, engine, format, startingColumn, startingRow, endingColumn, endingRow, threads, timed);
     
     return 0;
 }
 
 /* Function solveMaze
 
-   This function solves the maze by reading in a maze and then determining and print the FULL path or
-   PRUNED path.
+   This function solves the maze by reading in a maze, searching it with a solver engine and
+   printing the FULL or PRUNED result, streamed to the output file as it is formatted.
+   Ending coordinates are 1-based.
 
    Input: *mazeFileName - file name of maze to read in
+          rows, columns - the size of the maze
           *outputFileName - file name of where to write maze solution
+          *engine - the solver engine to search with
+          format - the path output format
           startColumn, startRow - coordinates of room location to start solving path from
           endColumn, endRow - coordinates of room location to solve path to
+          threads - the workers an engine may search with, 0 for every processor
+          timed - 1 to report load and search times on stderr
 
    Output: Void
  */
-void solveMaze(char *mazeFileName, char *outputFileName, int startColumn, int startRow, int endColumn, int endRow) {
-    /* reads a maze into memory and returns true if no error reading file */
+void solveMaze(char *mazeFileName, int rows, int columns, char *outputFileName, const struct solveEngine *engine,
+               int format, int startColumn, int startRow, int endColumn, int endRow, int threads, int timed) {
     #ifdef DEBUG
         printf("solveMaze: inside solveMaze\n");
     #endif
-    struct room maze[endRow][endColumn];
-        /* outputs PRUNED or FULL solution */
-    if(readMaze(maze, mazeFileName) == 0)
+    struct maze maze;
+    struct mazeIndex index = {0, 0, NULL, NULL, NULL, NULL, 0};
+    struct junctionGraph graph = {0, 0, 0, NULL, NULL, NULL, NULL, NULL, NULL};
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    loadMaze(&maze, &index, &graph, engine, mazeFileName, rows, columns);
+    if(timed)
+        reportTime("load", (double)rows * columns, "rooms", &start);
+    
+    if(roomOutOfBounds(startRow, startColumn, columns, rows) || roomOutOfBounds(endRow - 1, endColumn - 1, columns, rows))
     {
-        fprintf(stderr, "Error reading maze\n");
+        fprintf(stderr, "Starting/ending room is outside the maze\n");
         exit(0);
     }
     
-    struct linkedlist *solution = (struct linkedlist*)malloc(sizeof(struct linkedlist)); 
     #ifdef DEBUG
-        printf("solveMaze: Starting DFS with paramters: Maze File = %s Output File = %s Start Column=%d Start Row = %d End Column = %d End Row = %d\n", mazeFileName, outputFileName, startColumn, startRow, endColumn, endRow);
-    #endif
-    #ifdef FULL
-        fullDFS(startRow, startColumn, maze, endRow, endColumn, solution);
-    #else
-        prunedDFS(startRow, startColumn, maze, endRow, endColumn, solution);
+        printf("solveMaze: Starting %s with paramters: Maze File = %s Output File = %s Start Column=%d Start Row = %d End Column = %d End Row = %d\n", engine->name, mazeFileName, outputFileName, startColumn, startRow, endColumn, endRow);
     #endif
-    FILE *fp = fopen(outputFileName, "w+");
-    assert(fp != NULL);
-    #ifdef DEBUG
-        printf("solveMaze: starting printLL\n");
-    #endif  
-    printLL(solution, fp);
-    fclose(fp);
+    struct solveScratch scratch = {NULL, NULL, 0, 0, 0, &index, &graph, NULL, NULL, 0, 0, NULL, 0, threads};
+    struct solvePath path = {NULL, 0, 0};
+    uint32_t steps = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int found = format == PATH_DISTANCE ?
+                solveDistance(&maze, engine, startRow, startColumn, endRow - 1, endColumn - 1, &scratch, &path, &steps) :
+                engine->solve(&maze, startRow, startColumn, endRow - 1, endColumn - 1, &scratch, &path);
+    if(timed)
+    {
+        reportTime(engine->name, 1, "queries", &start);
+        fprintf(stderr, "%s: %zu rooms expanded\n", engine->name, scratch.expanded);
+    }
+    freeSolveScratch(&scratch);
+    if(found < 0)
+    {
+        fprintf(stderr, "Out of memory solving maze\n");
+        exit(0);
+    }
+    if(found == 0)
+        fprintf(stderr, "No path from %d, %d to %d, %d\n", startRow, startColumn, endRow - 1, endColumn - 1);
+    struct mazeWriter w;
+    struct pathText answer = {malloc(PATH_STREAM_SIZE), 0, PATH_STREAM_SIZE, &w};
+    if(openMazeWriter(&w, outputFileName) == 0)
+    {
+        fprintf(stderr, "Unable to open %s\n", outputFileName);
+        exit(0);
+    }
+    if(answer.text == NULL)
+    {
+        fprintf(stderr, "Out of memory writing solution\n");
+        exit(0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    writePathHeader(&w, format, rows, columns);
+    if(format == PATH_DISTANCE)
+        formatDistance(&answer, found, steps);
+    else
+        formatPath(&answer, &maze, engine, format, &path);
+    writeBytes(&w, answer.text, answer.length);
+    if(closeMazeWriter(&w) == 0)
+        fprintf(stderr, "Error writing %s\n", outputFileName);
+    if(timed)
+        reportTime("write", (double)path.length, "rooms", &start);
+    free(answer.text);
+    freeSolvePath(&path);
+    destroyJunctionGraph(&graph);
+    destroyMazeIndex(&index);
+    destroyMaze(&maze);
     #ifdef DEBUG
         printf("solveMaze: End solveMaze\n");
     #endif
 }
 
-/* Function roomHasOpenConnection
+/* Function writeDistanceField
 
-   Determines whether a room has open connection in direction
+   Writes the steps from one room to every room of a maze as a distance field
+   file. One breadth first search stores every distance in a flat array, which
+   is then written out a row at a time, narrowed to 16 bits through a row
+   buffer when asked. The room farthest from the start is reported on stderr.
 
-   Input: r - a room to evaluate
-          direction - the direction of the connection
- 
-   Output: Int 0 if room does not have open connection in direction and 1 if it does
-*/
-int roomHasOpenConnection(struct room r, int direction) {
-    switch(direction)
-    {
-        case EAST:
-            #ifdef DEBUG
-                printf("roomHasOpenConnection: r=%d, c=%d, east = %d\n", r.row, r.column, r.east);
-            #endif
-            return (r.east == OPENING ? 1 : 0);
-        case WEST:
-            return (r.west == OPENING ? 1 : 0);
-        case SOUTH:
-            return (r.south == OPENING ? 1 : 0);
-        default:
-            return (r.north == OPENING ? 1 : 0);
+   Input: *mazeFileName - file name of maze to read in
+          rows, columns - the size of the maze
+          *outputFileName - file name of where to write the distances, - for stdout
+          width - DISTANCE_UINT32 or DISTANCE_UINT16
+          startRow, startColumn - coordinates of the room to measure from
+          timed - 1 to report load, search and write times on stderr
+
+   Output: Void
+ */
+void writeDistanceField(char *mazeFileName, int rows, int columns, char *outputFileName, int width,
+                        int startRow, int startColumn, int timed) {
+    struct maze maze;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(readMaze(&maze, mazeFileName, rows, columns) == 0)
+    {
+        fprintf(stderr, "Error reading maze\n");
+        exit(0);
+    }
+    if(timed)
+        reportTime("load", (double)rows * columns, "rooms", &start);
+    if(roomOutOfBounds(startRow, startColumn, columns, rows))
+    {
+        fprintf(stderr, "Starting room is outside the maze\n");
+        exit(0);
+    }
+
+    size_t rooms = (size_t)rows * columns;
+    uint32_t *distances = malloc(rooms * sizeof(uint32_t));
+    uint16_t *narrow = width == DISTANCE_UINT16 ? malloc(columns * sizeof(uint16_t)) : NULL;
+    uint32_t farthest;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t reached = distances != NULL ? distanceField(&maze, startRow, startColumn, distances, &farthest) : 0;
+    if(reached == 0 || (width == DISTANCE_UINT16 && narrow == NULL))
+    {
+        fprintf(stderr, "Out of memory measuring distances\n");
+        exit(0);
+    }
+    if(timed)
+        reportTime("distances", (double)reached, "rooms", &start);
+    fprintf(stderr, "Farthest room from %d, %d: %u, %u at %u steps, %zu of %zu rooms reached\n", startRow, startColumn,
+            farthest / columns, farthest % columns, distances[farthest], reached, rooms);
+
+    struct mazeWriter w;
+    if(openMazeWriter(&w, outputFileName) == 0)
+    {
+        fprintf(stderr, "Unable to open %s\n", outputFileName);
+        exit(0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t clamped = 0;
+    int row, column;
+    for(row = 0; row < rows; row++)
+    {
+        const uint32_t *rowDistances = distances + (size_t)row * columns;
+        if(width == DISTANCE_UINT32)
+        {
+            writeBytes(&w, rowDistances, columns * sizeof(uint32_t));
+            continue;
+        }
+        for(column = 0; column < columns; column++)
+        {
+            uint32_t distance = rowDistances[column];
+            if(distance == UNREACHED)
+                narrow[column] = UINT16_MAX;
+            else if(distance > DISTANCE16_MAX)
+            {
+                narrow[column] = DISTANCE16_MAX;
+                clamped++;
+            }
+            else
+                narrow[column] = distance;
+        }
+        writeBytes(&w, narrow, columns * sizeof(uint16_t));
     }
+    if(closeMazeWriter(&w) == 0)
+        fprintf(stderr, "Error writing %s\n", outputFileName);
+    if(timed)
+        reportTime("write", (double)rooms, "rooms", &start);
+    if(clamped > 0)
+        fprintf(stderr, "%zu rooms are more than %d steps away, written as %d\n", clamped, DISTANCE16_MAX, DISTANCE16_MAX);
+    free(narrow);
+    free(distances);
+    destroyMaze(&maze);
 }
 
-/* Function createRoomFromHexValue
+/* Function writeMazeStats
 
-   Creates a room with connections initialized based on hex value
+   Writes a report of the measures of a maze, one "name: value" line each,
+   followed by the number of corridors in each range of lengths. The
+   branching factor is the mean number of ways on from a junction.
 
-   Input: hexValue - unsigned int that stores sum of room locations
-          row, column - the coordinates of the room to be initialized
+   Input: *mazeFileName - file name of maze to read in
+          rows, columns - the size of the maze
+          *outputFileName - file name of where to write the report, - for stdout
+          threads - the workers to measure with, 0 for every processor
+          timed - 1 to report load and analysis times on stderr
 
-   Output: A room with directions read in from hex sum and the given coordinates
-*/
-struct room createRoomFromHexValue(unsigned int hexValue, int row, int column) {
-    struct room rm;
-    
-    rm.row = row;
-    rm.column = column;
-    rm.visited = 0;
-    rm.east = OPENING;
-    rm.west = OPENING;
-    rm.south = OPENING;
-    rm.north = OPENING;
-    
-    if((hexValue & EASTHEX) == EASTHEX)
-        rm.east = WALL;
-    if((hexValue & WESTHEX) == WESTHEX)
-        rm.west = WALL;
-    if((hexValue & SOUTHHEX) == SOUTHHEX)
-        rm.south = WALL;
-    if((hexValue & NORTHHEX) == NORTHHEX)
-        rm.north = WALL;
-    
-    //temp debug code
-    //if(row == 0 && column == 0)
-        printf("createRoomFromHex: row = %d, column = %d, HexValue = %x, east = %d\n", row, column, hexValue, rm.east);
-    
-    return rm;
+   Output: Void
+ */
+void writeMazeStats(char *mazeFileName, int rows, int columns, char *outputFileName, int threads, int timed) {
+    struct maze maze;
+    struct mazeStats stats;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(readMaze(&maze, mazeFileName, rows, columns) == 0)
+    {
+        fprintf(stderr, "Error reading maze\n");
+        exit(0);
+    }
+    if(timed)
+        reportTime("load", (double)rows * columns, "rooms", &start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(analyzeMaze(&maze, threads, &stats) == 0)
+    {
+        fprintf(stderr, "Out of memory analyzing maze\n");
+        exit(0);
+    }
+    if(timed)
+        reportTime("stats", (double)stats.rooms, "rooms", &start);
+
+    FILE *fp = strcmp(outputFileName, "-") == 0 ? stdout : fopen(outputFileName, "w");
+    if(fp == NULL)
+    {
+        fprintf(stderr, "Unable to open %s\n", outputFileName);
+        exit(0);
+    }
+    uint64_t junctions = stats.degrees[3] + stats.degrees[4];
+    fprintf(fp, "rooms: %" PRIu64 "\n", stats.rooms);
+    fprintf(fp, "passages: %" PRIu64 "\n", stats.passages);
+    fprintf(fp, "one-way walls: %" PRIu64 "\n", stats.oneWayWalls);
+    fprintf(fp, "perfect: %s\n", stats.perfect ? "yes" : "no");
+    fprintf(fp, "reached from 0, 0: %" PRIu64 "\n", stats.reached);
+    fprintf(fp, "diameter: %u%s\n", stats.diameter, stats.perfect ? "" : " (at least)");
+    fprintf(fp, "diameter ends: %u, %u to %u, %u\n", stats.diameterEnds[0] / columns, stats.diameterEnds[0] % columns,
+            stats.diameterEnds[1] / columns, stats.diameterEnds[1] % columns);
+    fprintf(fp, "closed rooms: %" PRIu64 "\n", stats.degrees[0]);
+    fprintf(fp, "dead ends: %" PRIu64 " (%.2f%%)\n", stats.degrees[1], 100.0 * stats.degrees[1] / stats.rooms);
+    fprintf(fp, "corridor rooms: %" PRIu64 " (%.2f%%)\n", stats.degrees[2], 100.0 * stats.degrees[2] / stats.rooms);
+    fprintf(fp, "junctions: %" PRIu64 " (%.2f%%), %" PRIu64 " three-way, %" PRIu64 " four-way\n", junctions,
+            100.0 * junctions / stats.rooms, stats.degrees[3], stats.degrees[4]);
+    fprintf(fp, "branching factor: %.3f\n", junctions > 0 ? (2.0 * stats.degrees[3] + 3.0 * stats.degrees[4]) / junctions : 0.0);
+    fprintf(fp, "corridors: %" PRIu64 "\n", stats.corridors);
+    fprintf(fp, "mean corridor length: %.2f\n", stats.corridors > 0 ? (double)stats.corridorSteps / stats.corridors : 0.0);
+    fprintf(fp, "longest corridor: %u\n", stats.longestCorridor);
+    fprintf(fp, "corridor lengths:\n");
+    int b;
+    for(b = 0; b < CORRIDOR_BUCKETS; b++)
+    {
+        if(stats.corridorLengths[b] == 0)
+            continue;
+        uint64_t low = (uint64_t)1 << b, high = ((uint64_t)1 << (b + 1)) - 1;
+        if(low == high)
+            fprintf(fp, "  %" PRIu64 ": %" PRIu64 "\n", low, stats.corridorLengths[b]);
+        else
+            fprintf(fp, "  %" PRIu64 "-%" PRIu64 ": %" PRIu64 "\n", low, high, stats.corridorLengths[b]);
+    }
+    if((fp != stdout && fclose(fp) != 0) || (fp == stdout && fflush(fp) != 0))
+        fprintf(stderr, "Error writing %s\n", outputFileName);
+    destroyMaze(&maze);
 }
 
-/* Function readMaze
+/* Function writeMazeCheck
 
-   Reads in a maze from an input file and stores it internally in the room maze
+   Writes a report of the check of a maze, one "name: value" line each,
+   ending with whether the maze is perfect
 
-   Input: maze[][] - internal representation of all the rooms in maze
-          fileName - the file name of the maze to read in
+   Input: *mazeFileName - file name of maze to read in
+          rows, columns - the size of the maze
+          *outputFileName - file name of where to write the report, - for stdout
+          threads - the workers to check with, 0 for every processor
+          timed - 1 to report load and check times on stderr
 
-   Output: 0 if failed to read maze properly and 1 if maze was read properly
-*/
-int readMaze(struct room maze [MAZE_ROWS][MAZE_COLUMNS], char *fileName) {
-    FILE *fp = fopen(fileName, "r");
+   Output: 1 if the maze is perfect and 0 if it is not
+ */
+int writeMazeCheck(char *mazeFileName, int rows, int columns, char *outputFileName, int threads, int timed) {
+    struct maze maze;
+    struct mazeCheck check;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(readMaze(&maze, mazeFileName, rows, columns) == 0)
+    {
+        fprintf(stderr, "Error reading maze\n");
+        exit(1);
+    }
+    if(timed)
+        reportTime("load", (double)rows * columns, "rooms", &start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(checkMaze(&maze, threads, &check) == 0)
+    {
+        fprintf(stderr, "Out of memory checking maze\n");
+        exit(1);
+    }
+    if(timed)
+        reportTime("validate", (double)check.rooms, "rooms", &start);
+
+    FILE *fp = strcmp(outputFileName, "-") == 0 ? stdout : fopen(outputFileName, "w");
     if(fp == NULL)
-        return 0;
-    unsigned int hexValue;
-    int r,c;
-    r = 0;
-    c = 0;
-    while(fscanf(fp,"%1x", &hexValue) &&  r < MAZE_ROWS)
-    {
-        #ifdef DEBUG
-            printf("readMaze: hexValue = %x R = %d, C = %d\n", hexValue, r, c);
-        #endif
-        maze[r][c] = createRoomFromHexValue(hexValue, r, c);
-        if(c == MAZE_COLUMNS - 1)
+    {
+        fprintf(stderr, "Unable to open %s\n", outputFileName);
+        exit(1);
+    }
+    fprintf(fp, "rooms: %" PRIu64 "\n", check.rooms);
+    fprintf(fp, "east/west mismatches: %" PRIu64 "\n", check.eastWestMismatches);
+    fprintf(fp, "south/north mismatches: %" PRIu64 "\n", check.southNorthMismatches);
+    fprintf(fp, "open border sides: %" PRIu64 "\n", check.openBorderSides);
+    fprintf(fp, "passages: %" PRIu64 "\n", check.passages);
+    fprintf(fp, "components: %" PRIu64 "\n", check.components);
+    fprintf(fp, "cycles: %" PRIu64 "\n", check.cycles);
+    fprintf(fp, "perfect: %s\n", check.perfect ? "yes" : "no");
+    if((fp != stdout && fclose(fp) != 0) || (fp == stdout && fflush(fp) != 0))
+        fprintf(stderr, "Error writing %s\n", outputFileName);
+    destroyMaze(&maze);
+    return check.perfect;
+}
+
+/* Function solveQueries
+
+   Loads a maze once and answers a stream of queries against it, one per line
+   as "<starting row> <starting column> <ending row> <ending column>" with the
+   same coordinates as the command line. Blank lines and lines starting with #
+   are skipped. Queries are read QUERY_BLOCK at a time and answered by a pool
+   of worker threads sharing the read-only maze; answers are then written in
+   query order, each as the FULL or PRUNED output of a single solve, followed
+   by a blank line in the text and run-length formats, or as a line of its steps
+   in the distance format. A query that is malformed or outside the maze is reported on
+   stderr and answered with a header alone, or -1 for its steps, like a query
+   without a path, so answers stay in step with queries. Each worker keeps its scratch memory for
+   the whole stream, and each query starts a new generation of its marks
+   instead of clearing them.
+
+   Input: *mazeFileName - file name of maze to read in
+          rows, columns - the size of the maze
+          *outputFileName - file name of where to write the answers, or "-" for stdout
+          *engine - the solver engine to search with
+          format - the path output format
+          *queryFileName - the queries, or "-" for stdin
+          threads - the number of worker threads
+          timed - 1 to report load and query times on stderr
+
+   Output: Void
+ */
+void solveQueries(char *mazeFileName, int rows, int columns, char *outputFileName, const struct solveEngine *engine,
+                  int format, char *queryFileName, int threads, int timed) {
+    struct maze maze;
+    struct mazeIndex index = {0, 0, NULL, NULL, NULL, NULL, 0};
+    struct junctionGraph graph = {0, 0, 0, NULL, NULL, NULL, NULL, NULL, NULL};
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    loadMaze(&maze, &index, &graph, engine, mazeFileName, rows, columns);
+    if(timed)
+        reportTime("load", (double)rows * columns, "rooms", &start);
+    FILE *fp = strcmp(queryFileName, "-") == 0 ? stdin : fopen(queryFileName, "r");
+    if(fp == NULL)
+    {
+        fprintf(stderr, "Unable to open %s\n", queryFileName);
+        exit(0);
+    }
+    struct mazeWriter w;
+    if(openMazeWriter(&w, outputFileName) == 0)
+    {
+        fprintf(stderr, "Unable to open %s\n", outputFileName);
+        exit(0);
+    }
+    writePathHeader(&w, format, rows, columns);
+
+    struct queryBlock block;
+    block.maze = &maze;
+    block.engine = engine;
+    block.format = format;
+    block.queries = malloc(QUERY_BLOCK * sizeof(struct query));
+    block.arenas = calloc(threads, sizeof(struct pathText));
+    block.scratches = calloc(threads, sizeof(struct solveScratch));
+    block.paths = calloc(threads, sizeof(struct solvePath));
+    if(block.queries == NULL || block.arenas == NULL || block.scratches == NULL || block.paths == NULL)
+    {
+        fprintf(stderr, "Out of memory solving maze\n");
+        exit(0);
+    }
+    int i;
+    for(i = 0; i < threads; i++)
+    {
+        block.scratches[i].index = &index;
+        block.scratches[i].graph = &graph;
+        block.scratches[i].threads = 1;
+    }
+
+    char *line = NULL;
+    size_t lineCapacity = 0, lineNumber = 0, queries = 0;
+    int more = 1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while(more)
+    {
+        block.count = 0;
+        while(block.count < QUERY_BLOCK && (more = (getline(&line, &lineCapacity, fp) != -1)))
         {
-            c = 0;
-            r++;
+            lineNumber++;
+            char *p = line + strspn(line, " \t");
+            if(*p == '#' || *p == '\n' || *p == '\0')
+                continue;
+            struct query *q = &block.queries[block.count++];
+            q->lineNumber = lineNumber;
+            q->status = 0;
+            if(sscanf(p, "%d %d %d %d", &q->startRow, &q->startColumn, &q->endRow, &q->endColumn) != 4)
+                q->status = QUERY_MALFORMED;
+            else if(roomOutOfBounds(q->startRow, q->startColumn, columns, rows) ||
+                    roomOutOfBounds(q->endRow - 1, q->endColumn - 1, columns, rows))
+                q->status = QUERY_OUTSIDE;
         }
-        else
+        for(i = 0; i < threads; i++)
+            block.arenas[i].length = 0;
+        atomic_store(&block.nextQuery, 0);
+        if(block.count > 0 && runParallel(threads, answerQueries, &block) == 0)
         {
-            c++;
+            fprintf(stderr, "Unable to start query workers\n");
+            exit(0);
         }
+        size_t k;
+        for(k = 0; k < block.count; k++)
+        {
+            struct query *q = &block.queries[k];
+            if(q->status == QUERY_MALFORMED)
+                fprintf(stderr, "%s:%zu: expected <starting row> <starting column> <ending row> <ending column>\n", queryFileName, q->lineNumber);
+            else if(q->status == QUERY_OUTSIDE)
+                fprintf(stderr, "%s:%zu: starting/ending room is outside the maze\n", queryFileName, q->lineNumber);
+            else if(q->status == 0)
+                fprintf(stderr, "%s:%zu: no path from %d, %d to %d, %d\n", queryFileName, q->lineNumber, q->startRow, q->startColumn, q->endRow - 1, q->endColumn - 1);
+            else if(q->status < 0)
+            {
+                fprintf(stderr, "Out of memory solving maze\n");
+                exit(0);
+            }
+            writeBytes(&w, block.arenas[q->worker].text + q->offset, q->length);
+        }
+        queries += block.count;
     }
-    fclose(fp);
-    return 1;
+    if(timed)
+    {
+        size_t expanded = 0;
+        for(i = 0; i < threads; i++)
+            expanded += block.scratches[i].expanded;
+        reportTime(engine->name, (double)queries, "queries", &start);
+        fprintf(stderr, "%s: %zu rooms expanded (%.0f per query)\n", engine->name, expanded,
+                queries > 0 ? (double)expanded / queries : 0.0);
+    }
+    free(line);
+    if(fp != stdin)
+        fclose(fp);
+    if(closeMazeWriter(&w) == 0)
+        fprintf(stderr, "Error writing %s\n", outputFileName);
+    for(i = 0; i < threads; i++)
+    {
+        freeSolveScratch(&block.scratches[i]);
+        freeSolvePath(&block.paths[i]);
+        free(block.arenas[i].text);
+    }
+    free(block.queries);
+    free(block.arenas);
+    free(block.scratches);
+    free(block.paths);
+    destroyJunctionGraph(&graph);
+    destroyMazeIndex(&index);
+    destroyMaze(&maze);
 }
 
-/* Function printLL
+/* Function answerQueries
 
-   Prints linkedlist to file
+   Answers the queries of a block taken from a shared counter, searching with
+   the worker's own scratch memory and appending each answer, ended by a blank
+   line in the text and run-length formats, to the worker's text arena
 
-   Input: *p - pointer to a linkedlist
-          *filename - file of where to write contents of linkedlist
+   Input: *arg - the query block
+          id - the worker number, which picks its scratch memory, path and arena
 
    Output: Void
-*/
-void printLL(struct linkedlist *p, FILE *fileName) {
-    assert(fileName != NULL);
-    assert(p != NULL);
-    #ifdef FULL
-        fprintf(fileName, "FULL\n");
-    #else
-        fprintf(fileName, "PRUNED\n");
-    #endif
-    
-    struct linkedlist *temp;
-    #ifdef DEBUG
-        printf("printLL: starting loop\n");
-    #endif  
-    for(temp = p; temp != NULL;)
+ */
+void answerQueries(void *arg, int id) {
+    struct queryBlock *block = arg;
+    struct solveScratch *scratch = &block->scratches[id];
+    struct solvePath *path = &block->paths[id];
+    struct pathText *arena = &block->arenas[id];
+    size_t i;
+    while((i = atomic_fetch_add(&block->nextQuery, 1)) < block->count)
     {
-        fprintf(fileName, "%d, %d\n", temp->row, temp->column);
-        p = temp;
-        temp = temp->next;
-        free(p);
+        struct query *q = &block->queries[i];
+        path->length = 0;
+        q->worker = id;
+        q->offset = arena->length;
+        if(block->format == PATH_DISTANCE)
+        {
+            uint32_t steps = 0;
+            if(q->status == 0)
+                q->status = solveDistance(block->maze, block->engine, q->startRow, q->startColumn, q->endRow - 1, q->endColumn - 1,
+                                          scratch, path, &steps);
+            if(q->status >= 0 || q->status == QUERY_OUTSIDE || q->status == QUERY_MALFORMED)
+                if(formatDistance(arena, q->status, steps) == 0)
+                    q->status = -1;
+        }
+        else
+        {
+            if(q->status == 0)
+                q->status = block->engine->solve(block->maze, q->startRow, q->startColumn, q->endRow - 1, q->endColumn - 1, scratch, path);
+            if(q->status >= 0 || q->status == QUERY_OUTSIDE || q->status == QUERY_MALFORMED)
+            {
+                if(formatPath(arena, block->maze, block->engine, block->format, path) == 0)
+                    q->status = -1;
+                else if(block->format != PATH_PACKED)
+                    arena->text[arena->length++] = '\n';
+            }
+        }
+        q->length = arena->length - q->offset;
     }
-    #ifdef DEBUG
-        printf("printLL: end loop\n");
-    #endif  
 }
 
-/* Function fullDFS
+/* Function loadMaze
 
-   Performs a depth first search and writes FULL output path
+   Reads in a maze for a solver engine, exiting with a message if that fails.
+   An engine that answers from an index gets the index saved next to the maze
+   file as <maze file>.lca when it is current, and then the maze itself is
+   not read at all; otherwise the maze is read, indexed and the index saved
+   for the next run. An engine that searches a junction graph gets the graph
+   of the maze, built after it is read.
 
-   Input: row, column - coordinates of current location
-          targetRow, targetCol - coordinates of the goal
-          maze[][] - internal representation of all the rooms in maze
-          *fileName - file name of output file
+   Input: *maze - set to the maze, only its size when answered from a saved index
+          *index - set to the index when the engine uses one
+          *graph - set to the junction graph when the engine uses one
+          *engine - the solver engine the maze is for
+          fileName - the file name of the maze to read in
+          rows, columns - the expected size of the maze
 
-   Output: 0 representing false and 1 representing true per the requirements of dfs
+   Output: Void
 */
-int fullDFS(int row, int column, struct room maze [MAZE_ROWS][MAZE_COLUMNS], int targetRow, int targetCol, struct linkedlist *last){
-    if(row == (targetRow-1) && column == (targetCol-1))
-    {
-        struct linkedlist *temp = (struct linkedlist *)malloc(sizeof(struct linkedlist));
-        temp->row = row;
-        temp->column = column;
-        temp->next = NULL;
-        last->next = temp;
-        return 1;
-    }
-
-    maze[row][column].visited = 1;
-    
-    last->row = row;
-    last->column = column;
-    
-    int d = 0;
-    struct room *neighbor;
-    int tempR, tempC;
-    for(d = 0; d < 4; d++)
-    {
-        //Checking to see if maze has opening at direction D. roomHasOpenConnection returns 1 for open connection
-        neighbor = &maze[row][column];
-        #ifdef DEBUG
-            printf("fullDFS: roomHasOpenConnnection r=%d, c=%d, direction = %d, result=%d\n", row, column, d, roomHasOpenConnection(*neighbor, d));
-        #endif
-        if(roomHasOpenConnection(*neighbor, d))
+void loadMaze(struct maze *maze, struct mazeIndex *index, struct junctionGraph *graph, const struct solveEngine *engine,
+              char *fileName, int rows, int columns) {
+    char *indexFileName = NULL;
+    if(engine->usesIndex)
+    {
+        indexFileName = malloc(strlen(fileName) + 5);
+        assert(indexFileName != NULL);
+        sprintf(indexFileName, "%s.lca", fileName);
+        if(mapMazeIndex(index, indexFileName, fileName))
         {
-            tempR = row + SouthNorthOffset[d];
-            tempC = column + EastWestOffset[d];
-            neighbor = &maze[tempR][tempC];
-            #ifdef DEBUG
-                printf("fullDFS: roomHasOpenConnection (Neighbor): row=%d, col = %d, Direction = %d, result = %d, visited = %d\n", tempR, tempC, d,roomHasOpenConnection(*neighbor, d),     (*neighbor).visited);
-            #endif
-            if(roomOutOfBounds(tempR, tempC, targetCol, targetRow) == 0 &&(*neighbor).visited == 0) // && roomHasOpenConnection(*neighbor, d) == 1)
+            if(index->rows != rows || index->columns != columns)
             {
-                struct linkedlist *temp = (struct linkedlist *)malloc(sizeof(struct linkedlist));
-                temp->row = tempR;
-                temp->column = tempC;
-                #ifdef DEBUG
-                    printf("fullDFS: calling pruneDFS R=%d C=%d targetR=%d targetC=%d\n", (*neighbor).row, neighbor->column, targetRow, targetCol);
-                #endif          
-                if(fullDFS((*neighbor).row, (*neighbor).column, maze, targetRow, targetCol, temp) == 1)
-                {
-                    #ifdef DEBUG
-                        printf("fullDFS: linking list r=%d c=%d targetR=%d targetC=%d\n", neighbor->row, neighbor->column, targetRow, targetCol);
-                    #endif              
-                    last->next = temp;
-                    return 1;
-                }
-                else
-                {
-                    last->next = temp;
-                }
+                fprintf(stderr, "%s is a %d x %d maze\n", fileName, index->rows, index->columns);
+                exit(0);
             }
+            memset(maze, 0, sizeof(*maze));
+            maze->rows = rows;
+            maze->columns = columns;
+            free(indexFileName);
+            return;
         }
     }
-    #ifdef DEBUG
-        printf("fullDFS: end pruneDFS R=%d C=%d targetR=%d targetC=%d\n", row, column, targetRow, targetCol);
-    #endif
-    
-    return 0;
+    if(readMaze(maze, fileName, rows, columns) == 0)
+    {
+        fprintf(stderr, "Error reading maze\n");
+        exit(0);
+    }
+    if(engine->usesIndex)
+    {
+        int built = buildMazeIndex(index, maze);
+        if(built <= 0)
+        {
+            fprintf(stderr, built == 0 ? "%s is not a perfect maze, %s needs one\n" : "Unable to index %s for %s\n",
+                    fileName, engine->name);
+            exit(0);
+        }
+        if(saveMazeIndex(index, indexFileName, fileName) == 0)
+            fprintf(stderr, "Unable to save index %s\n", indexFileName);
+        free(indexFileName);
+    }
+    if(engine->usesGraph && buildJunctionGraph(graph, maze) < 0)
+    {
+        fprintf(stderr, "Unable to build the junction graph of %s\n", fileName);
+        exit(0);
+    }
+}
+
+/* Function reportTime
+
+   Reports on stderr how long a step took and how many things per second it handled
 
+   Input: *step - the name of the step
+          count - the number of things handled
+          *unit - what was handled
+          *start - when the step started, on CLOCK_MONOTONIC
+
+   Output: Void
+ */
+void reportTime(const char *step, double count, const char *unit, const struct timespec *start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+    fprintf(stderr, "%s: %.0f %s in %.3f s (%.0f %s/s)\n", step, count, unit, seconds, seconds > 0 ? count / seconds : 0.0, unit);
 }
 
+/* Function listEngines
+
+   Lists the solver engines one per line with their descriptions, which are
+   lined up past the longest engine name
+
+   Input: *fp - the file to list them to
+
+   Output: Void
+ */
+void listEngines(FILE *fp) {
+    const struct solveEngine *e;
+    int width = 0;
+    for(e = solveEngines; e->name != NULL; e++)
+        if((int)strlen(e->name) > width)
+            width = strlen(e->name);
+    for(e = solveEngines; e->name != NULL; e++)
+        fprintf(fp, "  %-*s %s\n", width, e->name, e->description);
+}
 
-/* Function prunedDFS
+/* Function readMaze
 
-   Performs a depth first search and writes PRUNED output path
+   Reads in a maze from an input file and stores it internally in the packed maze.
+   A hex maze file is decoded a row at a time through a lookup table, a binary
+   maze file is mapped and used in place instead of being read, and a tree maze
+   file is decoded from its parent directions.
 
-   Input: row, column - coordinates of current location
-          targetRow, targetCol - coordinates of the goal
-          maze[][] - internal representation of all the rooms in maze
-          *last - pointer to end of linked list that we can accumulate from for pruned lists
+   Input: *maze - internal representation of all the rooms in maze
+          fileName - the file name of the maze to read in
+          rows, columns - the expected size of the maze
 
-   Output: 0 representing false and 1 representing true per the requirements of dfs
+   Output: 0 if failed to read maze properly and 1 if maze was read properly
 */
-int prunedDFS(int row, int column, struct room maze [MAZE_ROWS][MAZE_COLUMNS], int targetRow, int targetCol, struct linkedlist *last) {
-    if(row == (targetRow-1) && column == (targetCol-1))
-    {
-        struct linkedlist *temp = (struct linkedlist *)malloc(sizeof(struct linkedlist));
-        temp->row = row;
-        temp->column = column;
-        temp->next = NULL;
-        last->next = temp;
+int readMaze(struct maze *maze, char *fileName, int rows, int columns) {
+    int format = mazeFileFormat(fileName);
+    if(format != FORMAT_HEX)
+    {
+        if(format == FORMAT_BINARY ? mapMazeFile(maze, fileName, NULL) == 0 : readTreeMazeFile(maze, fileName, NULL) == 0)
+            return 0;
+        if(maze->rows != rows || maze->columns != columns)
+        {
+            fprintf(stderr, "%s is a %d x %d maze\n", fileName, maze->rows, maze->columns);
+            destroyMaze(maze);
+            return 0;
+        }
         return 1;
     }
+    return readHexMazeFile(maze, fileName, rows, columns);
+}
 
-    maze[row][column].visited = 1;
-    
-    last->row = row;
-    last->column = column;
-    
-    int d = 0;
-    struct room *neighbor;
-    int tempR, tempC;
-    for(d = 0; d < 4; d++)
-    {
-        //Checking to see if maze has opening at direction D. roomHasOpenConnection returns 1 for open connection
-        neighbor = &maze[row][column];
-        #ifdef DEBUG
-            printf("pruneDFS: roomHasOpenConnnection r=%d, c=%d, direction = %d, result=%d\n", row, column, d, roomHasOpenConnection(*neighbor, d));
-        #endif
-        if(roomHasOpenConnection(*neighbor, d))
+/* Function reserveText
+
+   Makes room for more characters at the end of a text. A text with a sink
+   hands what it holds to the writer when full; an arena grows, at least
+   doubling.
+
+   Input: *t - the text
+          n - the number of characters to make room for, at most PATH_STREAM_SIZE with a sink
+
+   Output: 1 if there is room and 0 if out of memory
+*/
+static inline int reserveText(struct pathText *t, size_t n) {
+    if(t->length + n <= t->capacity)
+        return 1;
+    if(t->sink != NULL)
+    {
+        writeBytes(t->sink, t->text, t->length);
+        t->length = 0;
+        return 1;
+    }
+    size_t capacity = 2 * t->capacity > t->length + n ? 2 * t->capacity : t->length + n;
+    char *text = realloc(t->text, capacity);
+    if(text == NULL)
+        return 0;
+    t->text = text;
+    t->capacity = capacity;
+    return 1;
+}
+
+/* Function stepDirection
+
+   Finds the direction of a step between two rooms of a path and follows it.
+   Steps of a path through a maze turn at random, so this compares without
+   branching, and the column is carried from step to step by the comparisons
+   themselves rather than through the direction.
+
+   Input: *maze - the maze the path goes through
+          room, next - the room numbers
+          *column - the column of room, moved to the column of next
+
+   Output: The direction from room to next, or -1 if they are not next to each other
+*/
+static inline int stepDirection(const struct maze *maze, uint32_t room, uint32_t next, int *column) {
+    uint32_t step = next - room;
+    int east = (step == 1) & (*column + 1 < maze->columns);
+    int west = (step == UINT32_MAX) & (*column > 0);
+    int south = step == (uint32_t)maze->columns;
+    int north = step == -(uint32_t)maze->columns;
+    *column += east - west;
+    int d = west * WEST + south * SOUTH + north * NORTH;
+    return (east | west | south | north) ? d : -1;
+}
+
+/* Function formatRoom
+
+   Formats a room as a line of text output, "row, column"
+
+   Input: *text - where to format the line, at least 24 characters
+          row, column - the room
+
+   Output: The length of the line
+*/
+static size_t formatRoom(char *text, unsigned int row, unsigned int column) {
+    char digits[24];
+    size_t n = 0, length = 0;
+    do
+        digits[n++] = '0' + column % 10;
+    while((column /= 10) > 0);
+    digits[n++] = ' ';
+    digits[n++] = ',';
+    do
+        digits[n++] = '0' + row % 10;
+    while((row /= 10) > 0);
+    while(n > 0)
+        text[length++] = digits[--n];
+    text[length++] = '\n';
+    return length;
+}
+
+/* Function formatSegment
+
+   Appends a segment of a path, its first room and the steps from it to each
+   next room until one is not next to the room before, in a compact format.
+   RLE writes "row, column" and a letter per run of steps in one direction,
+   E, W, S or N, after the length of the run when it is longer than one step.
+   PACKED writes a pathSegmentHeader and the steps 2 bits each.
+
+   Input: *t - the text to append the segment to
+          *maze - the maze the path goes through
+          format - PATH_RLE or PATH_PACKED
+          *path - the room numbers of the path
+          first - the index in the path of the segment's first room
+
+   Output: The index in the path of the room after the segment, 0 if out of memory
+*/
+static size_t formatSegment(struct pathText *t, const struct maze *maze, int format, const struct solvePath *path, size_t first) {
+    static const char directionLetters[4] = {'E', 'W', 'S', 'N'};
+    const uint32_t *rooms = path->rooms;
+    int row = rooms[first] / maze->columns;
+    int column = rooms[first] - (uint32_t)row * maze->columns;
+    int startColumn = column;
+    size_t i = first + 1;
+    if(format == PATH_RLE)
+    {
+        if(reserveText(t, 24) == 0)
+            return 0;
+        t->length += formatRoom(t->text + t->length, row, column);
+        t->text[t->length - 1] = ' ';
+        int d = i < path->length ? stepDirection(maze, rooms[i - 1], rooms[i], &column) : -1;
+        while(d >= 0)
         {
-            tempR = row + SouthNorthOffset[d];
-            tempC = column + EastWestOffset[d];
-            neighbor = &maze[tempR][tempC];
-            #ifdef DEBUG
-                printf("pruneDFS: roomHasOpenConnection (Neighbor): row=%d, col = %d, Direction = %d, result = %d, visited = %d\n", tempR, tempC, d,roomHasOpenConnection(*neighbor, d),    (*neighbor).visited);
-            #endif
-            if(roomOutOfBounds(tempR, tempC, targetCol, targetRow) == 0 &&(*neighbor).visited == 0) // && roomHasOpenConnection(*neighbor, d) == 1)
+            size_t run = 1;
+            int next;
+            while((next = i + run < path->length ? stepDirection(maze, rooms[i + run - 1], rooms[i + run], &column) : -1) == d)
+                run++;
+            i += run;
+            if(reserveText(t, 24) == 0)
+                return 0;
+            if(run > 1)
             {
-                struct linkedlist *temp = (struct linkedlist *)malloc(sizeof(struct linkedlist));
-                temp->row = tempR;
-                temp->column = tempC;
-                #ifdef DEBUG
-                    printf("prunedDFS: calling pruneDFS R=%d C=%d targetR=%d targetC=%d\n", (*neighbor).row, neighbor->column, targetRow, targetCol);
-                #endif          
-                if(prunedDFS((*neighbor).row, (*neighbor).column, maze, targetRow, targetCol, temp) == 1)
-                {
-                    #ifdef DEBUG
-                        printf("prunedDFS: linking list r=%d c=%d targetR=%d targetC=%d\n", neighbor->row, neighbor->column, targetRow, targetCol);
-                    #endif              
-                    last->next = temp;
-                    return 1;
-                }
-                else
-                {
-                    #ifdef DEBUG
-                        printf("pruneDFS: freeing memory\n");
-                    #endif
-                    free(temp);
-                }
+                char digits[20];
+                size_t n = 0;
+                do
+                    digits[n++] = '0' + run % 10;
+                while((run /= 10) > 0);
+                while(n > 0)
+                    t->text[t->length++] = digits[--n];
             }
+            t->text[t->length++] = directionLetters[d];
+            d = next;
         }
+        if(i == first + 1)
+            t->length--;
+        t->text[t->length++] = '\n';
+        return i;
     }
-    #ifdef DEBUG
-        printf("prunedDFS: end pruneDFS R=%d C=%d targetR=%d targetC=%d\n", row, column, targetRow, targetCol);
-    #endif
-    
-    return 0;
+
+    size_t last = first;
+    while(last + 1 < path->length)
+    {
+        if(stepDirection(maze, rooms[last], rooms[last + 1], &column) < 0)
+            break;
+        last++;
+    }
+    struct pathSegmentHeader header = {row, startColumn, last - first};
+    if(reserveText(t, sizeof(header)) == 0)
+        return 0;
+    memcpy(t->text + t->length, &header, sizeof(header));
+    t->length += sizeof(header);
+    column = startColumn;
+    while(i <= last)
+    {
+        unsigned char packed = 0;
+        int shift;
+        for(shift = 0; shift < 8 && i <= last; shift += 2, i++)
+            packed |= stepDirection(maze, rooms[i - 1], rooms[i], &column) << shift;
+        if(reserveText(t, 1) == 0)
+            return 0;
+        t->text[t->length++] = packed;
+    }
+    return i;
+}
+
+/* Function formatPath
+
+   Appends the result of a search to a text, headed FULL or PRUNED by the
+   engine that found it. The text format has one "row, column" line per room;
+   the compact formats write the path as segments of steps between rooms next
+   to each other, which is the whole of a PRUNED path. There is always room
+   for one more character after the result.
+
+   Input: *t - the text to append the result to
+          *maze - the maze the path goes through
+          *engine - the solver engine that found the path
+          format - the path output format
+          *path - the room numbers of the path
+
+   Output: 1 if the result was formatted and 0 if out of memory
+*/
+int formatPath(struct pathText *t, const struct maze *maze, const struct solveEngine *engine, int format, const struct solvePath *path) {
+    size_t i;
+    if(format == PATH_PACKED)
+    {
+        struct pathRecordHeader header = {engine->full, path->length};
+        if(reserveText(t, sizeof(header)) == 0)
+            return 0;
+        memcpy(t->text + t->length, &header, sizeof(header));
+        t->length += sizeof(header);
+    }
+    else
+    {
+        const char *header = engine->full ? "FULL\n" : "PRUNED\n";
+        if(reserveText(t, strlen(header)) == 0)
+            return 0;
+        memcpy(t->text + t->length, header, strlen(header));
+        t->length += strlen(header);
+    }
+    if(format == PATH_TEXT)
+    {
+        for(i = 0; i < path->length; i++)
+        {
+            if(reserveText(t, 24) == 0)
+                return 0;
+            t->length += formatRoom(t->text + t->length, path->rooms[i] / maze->columns, path->rooms[i] % maze->columns);
+        }
+    }
+    else
+    {
+        for(i = 0; i < path->length; )
+            if((i = formatSegment(t, maze, format, path, i)) == 0)
+                return 0;
+    }
+    return reserveText(t, 1);
+}
+
+/* Function solveDistance
+
+   Finds the number of steps on the path between two rooms. An engine that
+   answers from an index takes them from the depths of the two rooms and of
+   their lowest common ancestor, in O(log n) without building the path; any
+   other engine searches for the path and counts its steps.
+
+   Input: *maze - the maze to search
+          *engine - the solver engine to search with
+          startRow, startColumn - the room to start from
+          endRow, endColumn - the room to find the steps to
+          *scratch - search scratch memory, holding the index for an engine that uses one
+          *path - where the path is stored while searching
+          *steps - set to the number of steps when a path was found
+
+   Output: 1 if a path was found, 0 if the end cannot be reached and -1 if out of memory
+*/
+int solveDistance(const struct maze *maze, const struct solveEngine *engine, int startRow, int startColumn, int endRow, int endColumn,
+                  struct solveScratch *scratch, struct solvePath *path, uint32_t *steps) {
+    if(engine->usesIndex)
+    {
+        const struct mazeIndex *x = scratch->index;
+        if(x == NULL || x->rows != maze->rows || x->columns != maze->columns)
+            return -1;
+        *steps = indexDistance(x, (uint32_t)startRow * maze->columns + startColumn, (uint32_t)endRow * maze->columns + endColumn);
+        return 1;
+    }
+    int found = engine->solve(maze, startRow, startColumn, endRow, endColumn, scratch, path);
+    if(found == 1)
+        *steps = path->length - 1;
+    return found;
+}
+
+/* Function formatDistance
+
+   Appends the steps of a path to a text as a line, or -1 when there is no
+   path. There is always room for one more character after the line.
+
+   Input: *t - the text to append the line to
+          found - 1 if there is a path
+          steps - the number of steps on the path
+
+   Output: 1 if the line was formatted and 0 if out of memory
+*/
+int formatDistance(struct pathText *t, int found, uint32_t steps) {
+    if(reserveText(t, 12) == 0)
+        return 0;
+    t->length += found == 1 ? sprintf(t->text + t->length, "%" PRIu32 "\n", steps) : sprintf(t->text + t->length, "-1\n");
+    return reserveText(t, 1);
+}
+
+/* Function writePathHeader
+
+   Writes what comes before the answers in a path output format: a
+   pathFileHeader for the packed format and nothing for the text formats
+
+   Input: *w - the writer
+          format - the path output format
+          rows, columns - the size of the maze
+
+   Output: Void
+*/
+void writePathHeader(struct mazeWriter *w, int format, int rows, int columns) {
+    if(format != PATH_PACKED)
+        return;
+    struct pathFileHeader header;
+    memcpy(header.magic, PATH_MAGIC, sizeof(header.magic));
+    header.version = PATH_FORMAT_VERSION;
+    header.rows = rows;
+    header.columns = columns;
+    writeBytes(w, &header, sizeof(header));
 }